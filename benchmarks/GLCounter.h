@@ -0,0 +1,271 @@
+/*
+	Counts the GL calls and draw calls the benchmark scenes make.
+
+	Every GL function main.cpp calls is replaced by a wrapper that bumps the counters and then makes the real
+	call, so glCalls counts all of them, including the glFinish that ends each measured frame. The wrapper is
+	defined before the name is redefined, so the call inside it still expands to the real entry point (GLEW's
+	function pointer, or libGL's function for the GL 1.1 ones). A function that isn't wrapped here isn't
+	counted, so run.sh checks that everything main.cpp calls has a line here and won't run the suite if not.
+
+	Include it after GL/glew.h and before the code to be counted, from one .cpp file only.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <GL/glew.h>
+
+//=========
+//COUNTERS
+//=========
+
+//running totals, take the difference between two reads to count a frame
+uint64_t glCalls = 0;
+uint64_t drawCalls = 0;
+
+#define COUNTED_GL_CALL(returns, name, params, args) \
+	inline returns counted_##name params { \
+		glCalls++; \
+		return name args; \
+	}
+
+#define COUNTED_GL_DRAW(returns, name, params, args) \
+	inline returns counted_##name params { \
+		glCalls++; \
+		drawCalls++; \
+		return name args; \
+	}
+
+//=========
+//WRAPPERS
+//=========
+
+//state, clearing and queries
+COUNTED_GL_CALL(void, glClearColor, (GLclampf r, GLclampf g, GLclampf b, GLclampf a), (r, g, b, a))
+#undef glClearColor
+#define glClearColor counted_glClearColor
+
+COUNTED_GL_CALL(void, glClear, (GLbitfield mask), (mask))
+#undef glClear
+#define glClear counted_glClear
+
+COUNTED_GL_CALL(void, glEnable, (GLenum cap), (cap))
+#undef glEnable
+#define glEnable counted_glEnable
+
+COUNTED_GL_CALL(void, glDisable, (GLenum cap), (cap))
+#undef glDisable
+#define glDisable counted_glDisable
+
+COUNTED_GL_CALL(void, glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+#undef glViewport
+#define glViewport counted_glViewport
+
+COUNTED_GL_CALL(void, glFinish, (), ())
+#undef glFinish
+#define glFinish counted_glFinish
+
+COUNTED_GL_CALL(GLenum, glGetError, (), ())
+#undef glGetError
+#define glGetError counted_glGetError
+
+COUNTED_GL_CALL(const GLubyte*, glGetString, (GLenum name), (name))
+#undef glGetString
+#define glGetString counted_glGetString
+
+//shaders and programs
+COUNTED_GL_CALL(GLuint, glCreateShader, (GLenum type), (type))
+#undef glCreateShader
+#define glCreateShader counted_glCreateShader
+
+COUNTED_GL_CALL(void, glShaderSource,
+	(GLuint shader, GLsizei count, const GLchar* const* source, const GLint* length),
+	(shader, count, source, length))
+#undef glShaderSource
+#define glShaderSource counted_glShaderSource
+
+COUNTED_GL_CALL(void, glCompileShader, (GLuint shader), (shader))
+#undef glCompileShader
+#define glCompileShader counted_glCompileShader
+
+COUNTED_GL_CALL(void, glGetShaderiv, (GLuint shader, GLenum name, GLint* value), (shader, name, value))
+#undef glGetShaderiv
+#define glGetShaderiv counted_glGetShaderiv
+
+COUNTED_GL_CALL(void, glGetShaderInfoLog,
+	(GLuint shader, GLsizei size, GLsizei* length, GLchar* log),
+	(shader, size, length, log))
+#undef glGetShaderInfoLog
+#define glGetShaderInfoLog counted_glGetShaderInfoLog
+
+COUNTED_GL_CALL(void, glDeleteShader, (GLuint shader), (shader))
+#undef glDeleteShader
+#define glDeleteShader counted_glDeleteShader
+
+COUNTED_GL_CALL(GLuint, glCreateProgram, (), ())
+#undef glCreateProgram
+#define glCreateProgram counted_glCreateProgram
+
+COUNTED_GL_CALL(void, glAttachShader, (GLuint program, GLuint shader), (program, shader))
+#undef glAttachShader
+#define glAttachShader counted_glAttachShader
+
+COUNTED_GL_CALL(void, glLinkProgram, (GLuint program), (program))
+#undef glLinkProgram
+#define glLinkProgram counted_glLinkProgram
+
+COUNTED_GL_CALL(void, glGetProgramiv, (GLuint program, GLenum name, GLint* value), (program, name, value))
+#undef glGetProgramiv
+#define glGetProgramiv counted_glGetProgramiv
+
+COUNTED_GL_CALL(void, glDeleteProgram, (GLuint program), (program))
+#undef glDeleteProgram
+#define glDeleteProgram counted_glDeleteProgram
+
+COUNTED_GL_CALL(void, glUseProgram, (GLuint program), (program))
+#undef glUseProgram
+#define glUseProgram counted_glUseProgram
+
+COUNTED_GL_CALL(GLint, glGetAttribLocation, (GLuint program, const GLchar* name), (program, name))
+#undef glGetAttribLocation
+#define glGetAttribLocation counted_glGetAttribLocation
+
+COUNTED_GL_CALL(GLint, glGetUniformLocation, (GLuint program, const GLchar* name), (program, name))
+#undef glGetUniformLocation
+#define glGetUniformLocation counted_glGetUniformLocation
+
+COUNTED_GL_CALL(void, glUniformMatrix4fv,
+	(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value),
+	(location, count, transpose, value))
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv counted_glUniformMatrix4fv
+
+COUNTED_GL_CALL(void, glUniform1i, (GLint location, GLint value), (location, value))
+#undef glUniform1i
+#define glUniform1i counted_glUniform1i
+
+//buffers and vertex attributes
+COUNTED_GL_CALL(void, glGenBuffers, (GLsizei count, GLuint* buffers), (count, buffers))
+#undef glGenBuffers
+#define glGenBuffers counted_glGenBuffers
+
+COUNTED_GL_CALL(void, glBindBuffer, (GLenum target, GLuint buffer), (target, buffer))
+#undef glBindBuffer
+#define glBindBuffer counted_glBindBuffer
+
+COUNTED_GL_CALL(void, glBufferData,
+	(GLenum target, GLsizeiptr size, const void* data, GLenum usage),
+	(target, size, data, usage))
+#undef glBufferData
+#define glBufferData counted_glBufferData
+
+COUNTED_GL_CALL(void, glDeleteBuffers, (GLsizei count, const GLuint* buffers), (count, buffers))
+#undef glDeleteBuffers
+#define glDeleteBuffers counted_glDeleteBuffers
+
+COUNTED_GL_CALL(void, glEnableVertexAttribArray, (GLuint index), (index))
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray counted_glEnableVertexAttribArray
+
+COUNTED_GL_CALL(void, glDisableVertexAttribArray, (GLuint index), (index))
+#undef glDisableVertexAttribArray
+#define glDisableVertexAttribArray counted_glDisableVertexAttribArray
+
+COUNTED_GL_CALL(void, glVertexAttribPointer,
+	(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer),
+	(index, size, type, normalized, stride, pointer))
+#undef glVertexAttribPointer
+#define glVertexAttribPointer counted_glVertexAttribPointer
+
+//textures
+COUNTED_GL_CALL(void, glGenTextures, (GLsizei count, GLuint* textures), (count, textures))
+#undef glGenTextures
+#define glGenTextures counted_glGenTextures
+
+COUNTED_GL_CALL(void, glActiveTexture, (GLenum texture), (texture))
+#undef glActiveTexture
+#define glActiveTexture counted_glActiveTexture
+
+COUNTED_GL_CALL(void, glBindTexture, (GLenum target, GLuint texture), (target, texture))
+#undef glBindTexture
+#define glBindTexture counted_glBindTexture
+
+COUNTED_GL_CALL(void, glTexParameteri, (GLenum target, GLenum name, GLint value), (target, name, value))
+#undef glTexParameteri
+#define glTexParameteri counted_glTexParameteri
+
+COUNTED_GL_CALL(void, glTexImage2D,
+	(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels),
+	(target, level, internalFormat, width, height, border, format, type, pixels))
+#undef glTexImage2D
+#define glTexImage2D counted_glTexImage2D
+
+COUNTED_GL_CALL(void, glGenerateMipmap, (GLenum target), (target))
+#undef glGenerateMipmap
+#define glGenerateMipmap counted_glGenerateMipmap
+
+COUNTED_GL_CALL(void, glDeleteTextures, (GLsizei count, const GLuint* textures), (count, textures))
+#undef glDeleteTextures
+#define glDeleteTextures counted_glDeleteTextures
+
+//framebuffers and reading back
+COUNTED_GL_CALL(void, glGenRenderbuffers, (GLsizei count, GLuint* renderbuffers), (count, renderbuffers))
+#undef glGenRenderbuffers
+#define glGenRenderbuffers counted_glGenRenderbuffers
+
+COUNTED_GL_CALL(void, glBindRenderbuffer, (GLenum target, GLuint renderbuffer), (target, renderbuffer))
+#undef glBindRenderbuffer
+#define glBindRenderbuffer counted_glBindRenderbuffer
+
+COUNTED_GL_CALL(void, glRenderbufferStorage,
+	(GLenum target, GLenum format, GLsizei width, GLsizei height),
+	(target, format, width, height))
+#undef glRenderbufferStorage
+#define glRenderbufferStorage counted_glRenderbufferStorage
+
+COUNTED_GL_CALL(void, glDeleteRenderbuffers,
+	(GLsizei count, const GLuint* renderbuffers),
+	(count, renderbuffers))
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers counted_glDeleteRenderbuffers
+
+COUNTED_GL_CALL(void, glGenFramebuffers, (GLsizei count, GLuint* framebuffers), (count, framebuffers))
+#undef glGenFramebuffers
+#define glGenFramebuffers counted_glGenFramebuffers
+
+COUNTED_GL_CALL(void, glBindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer))
+#undef glBindFramebuffer
+#define glBindFramebuffer counted_glBindFramebuffer
+
+COUNTED_GL_CALL(void, glFramebufferRenderbuffer,
+	(GLenum target, GLenum attachment, GLenum renderbufferTarget, GLuint renderbuffer),
+	(target, attachment, renderbufferTarget, renderbuffer))
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer counted_glFramebufferRenderbuffer
+
+COUNTED_GL_CALL(GLenum, glCheckFramebufferStatus, (GLenum target), (target))
+#undef glCheckFramebufferStatus
+#define glCheckFramebufferStatus counted_glCheckFramebufferStatus
+
+COUNTED_GL_CALL(void, glDeleteFramebuffers,
+	(GLsizei count, const GLuint* framebuffers),
+	(count, framebuffers))
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers counted_glDeleteFramebuffers
+
+COUNTED_GL_CALL(void, glReadPixels,
+	(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels),
+	(x, y, width, height, format, type, pixels))
+#undef glReadPixels
+#define glReadPixels counted_glReadPixels
+
+//draws
+COUNTED_GL_DRAW(void, glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+#undef glDrawArrays
+#define glDrawArrays counted_glDrawArrays
+
+COUNTED_GL_DRAW(void, glDrawElements,
+	(GLenum mode, GLsizei count, GLenum type, const void* indices),
+	(mode, count, type, indices))
+#undef glDrawElements
+#define glDrawElements counted_glDrawElements
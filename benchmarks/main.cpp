@@ -0,0 +1,945 @@
+/*
+	Performance regression suite. Renders canonical scenes taken from the demos, and scaled up stress versions
+	of them, into an offscreen framebuffer with no window on screen. For each scene it measures frame time,
+	draw calls, GL calls, heap allocations and memory, compares the final image against a golden image and
+	compares the measurements against baseline.txt. If anything got worse by more than the tolerances in
+	thresholds.txt it exits with 1, so it can be used to stop a regression before it's merged.
+
+	The counts and the images don't depend on the machine, as long as it renders with llvmpipe (Mesa is asked
+	for it), so they are always checked. Timings and memory only mean something next to a baseline made on
+	the same renderer and CPU, so baseline.txt records the machine it was made on and those are only checked
+	when it matches. Anywhere else they are just reported, until --update-baseline is run there. run.sh builds
+	the suite and runs it from this directory.
+*/
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "../firstCube/Allocators.h"
+#include "../firstTexture/ImageDecoder.h"
+//everything after this is counted
+#include "GLCounter.h"
+
+//================
+//GLOBAL VARIABLES
+//================
+
+//the scenes render into this instead of a window, so the images are the same size everywhere
+const int TARGET_SIZE = 256;
+GLuint framebuffer, colorBuffer, depthBuffer;
+
+//frames rendered before measuring starts, and the animation time the golden images are taken at
+const int WARMUP_FRAMES = 10;
+const float GOLDEN_TIME = 1.5f;
+const float FRAME_TIME = 1.0f / 60.0f;
+
+//=======
+//SHADERS
+//=======
+
+bool readFile(const std::string &fileName, std::string &contents) {
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if(file.fail()) {
+		perror(fileName.c_str());
+		return false;
+	}
+	contents.assign(file.tellg(), '\0');
+	file.seekg(0);
+	file.read(&contents[0], contents.size());
+	return true;
+}
+
+GLuint compileShader(GLenum type, const char* source, const char* name) {
+	GLuint id = glCreateShader(type);
+	glShaderSource(id, 1, &source, NULL);
+	glCompileShader(id);
+	GLint compileOK = GL_FALSE;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &compileOK);
+	if(!compileOK) {
+		std::cerr << "ERROR: " << name << " FAILED TO COMPILE\n";
+		GLint maxLength = 0;
+		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &maxLength);
+		std::vector<char> errorLog(std::max(1, maxLength));
+		glGetShaderInfoLog(id, maxLength, &maxLength, &errorLog[0]);
+		std::printf("%s\n", &errorLog[0]);
+		glDeleteShader(id);
+		return 0;
+	}
+	return id;
+}
+
+//compile and link a program, returns 0 if either shader or the link failed
+GLuint buildProgram(const char* vertexSource, const char* fragSource, const char* name) {
+	GLuint vertexID = compileShader(GL_VERTEX_SHADER, vertexSource, name);
+	GLuint fragID = compileShader(GL_FRAGMENT_SHADER, fragSource, name);
+	if(vertexID == 0 || fragID == 0) {
+		glDeleteShader(vertexID);
+		glDeleteShader(fragID);
+		return 0;
+	}
+	GLuint programID = glCreateProgram();
+	glAttachShader(programID, vertexID);
+	glAttachShader(programID, fragID);
+	glLinkProgram(programID);
+	glDeleteShader(vertexID);
+	glDeleteShader(fragID);
+	GLint linkOK = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkOK);
+	if(!linkOK) {
+		std::cerr << "ERROR: " << name << " could not be linked\n";
+		glDeleteProgram(programID);
+		return 0;
+	}
+	return programID;
+}
+
+//the cube scenes use the demos' own shader files, so a change to them shows up here
+GLuint loadProgram(const std::string &vertexFile, const std::string &fragFile) {
+	std::string vertexSource, fragSource;
+	if(!readFile(vertexFile, vertexSource) || !readFile(fragFile, fragSource)) {
+		return 0;
+	}
+	return buildProgram(vertexSource.c_str(), fragSource.c_str(), vertexFile.c_str());
+}
+
+bool findAttribute(GLuint programID, const char* name, GLint &location) {
+	location = glGetAttribLocation(programID, name);
+	if(location == -1) {
+		std::cerr << "Could not bind attribute: " << name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//======================
+//TRIANGLE & QUAD SCENES
+//======================
+
+//FirstTriangle and firstQuad: a 2D shape drawn from a client side array with the demos' shaders.
+//Scaled up, the shape is repeated in a scale x scale grid. The triangles all go in one draw, to stress
+//vertex throughput, and the quads get a draw each, to stress the cost of a draw call.
+GLuint shapeProgram;
+GLint attribute_coord2d;
+std::vector<GLfloat> shapeVerticies;
+int shapeVertexCount; //verticies in one shape
+bool drawEachShape;
+
+const char* shapeVertexSource =
+	"#version 120\n"
+	"attribute vec2 coord2d;\n"
+	"void main() {"
+		"gl_Position = vec4(coord2d, 0.0, 1.0);"
+	"}";
+//the demos' shader leaves alpha unset, which is undefined, so this copy writes it to keep the goldens stable
+const char* shapeFragSource =
+	"#version 120\n"
+	"void main() {"
+		"gl_FragColor[0] = gl_FragCoord.x/600;" //red
+		"gl_FragColor[1] = gl_FragCoord.y/600;" //green
+		"gl_FragColor[2] = 0.5;" //blue
+		"gl_FragColor[3] = 1.0;" //alpha
+	"}";
+
+bool initShapes(const GLfloat* shape, int vertexCount, int scale, bool drawEach) {
+	shapeProgram = buildProgram(shapeVertexSource, shapeFragSource, "shape shader");
+	if(shapeProgram == 0 || !findAttribute(shapeProgram, "coord2d", attribute_coord2d)) {
+		return false;
+	}
+	shapeVertexCount = vertexCount;
+	drawEachShape = drawEach;
+	shapeVerticies.resize((size_t)scale * scale * vertexCount * 2);
+	GLfloat* vertex = shapeVerticies.data();
+	float cellSize = 2.0f / scale;
+	for(int y = 0; y < scale; y++) {
+		for(int x = 0; x < scale; x++) {
+			float centerX = -1.0f + (x + 0.5f) * cellSize;
+			float centerY = -1.0f + (y + 0.5f) * cellSize;
+			for(int i = 0; i < vertexCount; i++) {
+				*vertex++ = centerX + shape[i*2] / scale;
+				*vertex++ = centerY + shape[i*2 + 1] / scale;
+			}
+		}
+	}
+	return true;
+}
+
+bool initTriangles(int scale) {
+	const GLfloat triangle[] = {
+		0.0,  0.5,
+	   -0.5, -0.5,
+		0.5, -0.5
+	};
+	return initShapes(triangle, 3, scale, false);
+}
+
+bool initQuads(int scale) {
+	const GLfloat quad[] = {
+		0.5,  0.5,
+	   -0.5, -0.5,
+		0.5, -0.5,
+
+	   -0.5, -0.5,
+	   -0.5,  0.5,
+		0.5,  0.5
+	};
+	return initShapes(quad, 6, scale, true);
+}
+
+void renderShapes(float) {
+	glClearColor(1.0, 1.0, 1.0, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glUseProgram(shapeProgram);
+	glEnableVertexAttribArray(attribute_coord2d);
+	int totalVerticies = shapeVerticies.size() / 2;
+	if(drawEachShape) {
+		for(int first = 0; first < totalVerticies; first += shapeVertexCount) {
+			glVertexAttribPointer(attribute_coord2d, 2, GL_FLOAT, GL_FALSE, 0, &shapeVerticies[first * 2]);
+			glDrawArrays(GL_TRIANGLES, 0, shapeVertexCount);
+		}
+	} else {
+		glVertexAttribPointer(attribute_coord2d, 2, GL_FLOAT, GL_FALSE, 0, shapeVerticies.data());
+		glDrawArrays(GL_TRIANGLES, 0, totalVerticies);
+	}
+	glDisableVertexAttribArray(attribute_coord2d);
+}
+
+void freeShapes() {
+	glDeleteProgram(shapeProgram);
+	std::vector<GLfloat>().swap(shapeVerticies);
+}
+
+//===========
+//CUBE SCENES
+//===========
+
+//firstCube's colored cube and firstTexture's crate, with the same geometry, shaders, camera and animation
+//as the demos. Scaled up, a scale x scale grid of smaller cubes is drawn with a draw call each.
+GLuint cubeProgram, vbo_verticies, vbo_attribute, ibo_elements, crateTexture;
+GLint attribute_coord3d, attribute_second, uniform_mvp;
+int secondComponents; //3 for colors, 2 for texture coordinates
+int cubeIndexCount;
+bool texturedCube;
+glm::mat4 cubeViewProjection;
+std::vector<glm::mat4> cubeModels;
+
+GLuint createBuffer(GLenum target, const void* data, size_t size) {
+	GLuint bufferID;
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(target, bufferID);
+	glBufferData(target, size, data, GL_STATIC_DRAW);
+	return bufferID;
+}
+
+//lay the cubes out in a grid in front of the camera. With a scale of 1 it's the demo's one cube.
+void placeCubes(int scale, float distance) {
+	cubeModels.resize((size_t)scale * scale);
+	float spacing = 2.4f / scale;
+	for(int y = 0; y < scale; y++) {
+		for(int x = 0; x < scale; x++) {
+			glm::vec3 center((x - (scale - 1) / 2.0f) * spacing, (y - (scale - 1) / 2.0f) * spacing, -distance);
+			cubeModels[y * scale + x] = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(1.0f / scale));
+		}
+	}
+}
+
+bool initColoredCubes(int scale) {
+	GLfloat verticies[] = {
+		//front of cube
+		-1.0, -1.0, 1.0,
+		 1.0, -1.0, 1.0,
+		 1.0,  1.0, 1.0,
+		-1.0,  1.0, 1.0,
+		//back of cube
+		-1.0,-1.0, -1.0,
+		 1.0,-1.0, -1.0,
+		 1.0, 1.0,  -1.0,
+		-1.0, 1.0, -1.0
+	};
+	GLfloat color[] = {
+		//front colors
+		1.0, 0.0, 0.0,
+		0.0, 1.0, 0.0,
+		0.0, 0.0, 1.0,
+		1.0, 1.0, 1.0,
+		//back colors
+		1.0, 0.0, 0.0,
+		0.0, 1.0, 0.0,
+		0.0, 0.0, 1.0,
+		1.0, 1.0, 1.0
+	};
+	GLushort cube_elements[] = {
+		0, 1, 2,  2, 3, 0, // front
+		1, 5, 6,  6, 2, 1, // right
+		7, 6, 5,  5, 4, 7, // back
+		4, 0, 3,  3, 7, 4, // left
+		4, 5, 1,  1, 0, 4, // bottom
+		3, 2, 6,  6, 7, 3  // top
+	};
+	vbo_verticies = createBuffer(GL_ARRAY_BUFFER, verticies, sizeof(verticies));
+	vbo_attribute = createBuffer(GL_ARRAY_BUFFER, color, sizeof(color));
+	ibo_elements = createBuffer(GL_ELEMENT_ARRAY_BUFFER, cube_elements, sizeof(cube_elements));
+	cubeIndexCount = sizeof(cube_elements) / sizeof(GLushort);
+	secondComponents = 3;
+	texturedCube = false;
+	crateTexture = 0;
+
+	cubeProgram = loadProgram("../firstCube/CubeVertexShader.glsl", "../firstCube/CubeFragShader.glsl");
+	if(cubeProgram == 0 || !findAttribute(cubeProgram, "coord3d", attribute_coord3d) ||
+		!findAttribute(cubeProgram, "v_color", attribute_second)) {
+		return false;
+	}
+	uniform_mvp = glGetUniformLocation(cubeProgram, "mvp");
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0, 2.0, 0.0), glm::vec3(0.0, 0.0, -4.0), glm::vec3(0.0, 1.0, 0.0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 10.0f);
+	cubeViewProjection = projection * view;
+	placeCubes(scale, 4.0f);
+	return true;
+}
+
+bool initTexturedCubes(int scale) {
+	DecodedImage image;
+	if(!ImageDecoder::decodeFile("../firstTexture/woodenCrate.png", image)) {
+		std::cerr << "woodenCrate.png: " << image.error << std::endl;
+		return false;
+	}
+	glGenTextures(1, &crateTexture);
+	glBindTexture(GL_TEXTURE_2D, crateTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	GLfloat cube_texcoords[2*4*6] = {
+		0.0, 0.0,
+		1.0, 0.0,
+		1.0, 1.0,
+		0.0, 1.0
+	};
+	for(int i = 1; i < 6; i++) {
+		memcpy(&cube_texcoords[i*4*2], &cube_texcoords[0], 2*4*sizeof(GLfloat));
+	}
+	GLfloat verticies[] = {
+		//front of cube
+		-1.0, -1.0,  1.0,   1.0, -1.0,  1.0,   1.0,  1.0,  1.0,  -1.0,  1.0,  1.0,
+		//top of cube
+		-1.0,  1.0,  1.0,   1.0,  1.0,  1.0,   1.0,  1.0, -1.0,  -1.0,  1.0, -1.0,
+		//back of cube
+		 1.0, -1.0, -1.0,  -1.0, -1.0, -1.0,  -1.0,  1.0, -1.0,   1.0,  1.0, -1.0,
+		//bottom of cube
+		-1.0, -1.0, -1.0,   1.0, -1.0, -1.0,   1.0, -1.0,  1.0,  -1.0, -1.0,  1.0,
+		//left of cube
+		-1.0, -1.0, -1.0,  -1.0, -1.0,  1.0,  -1.0,  1.0,  1.0,  -1.0,  1.0, -1.0,
+		//right of cube
+		 1.0, -1.0,  1.0,   1.0, -1.0, -1.0,   1.0,  1.0, -1.0,   1.0,  1.0,  1.0
+	};
+	GLushort cube_elements[] = {
+		 0,  1,  2,   2,  3,  0, // front
+		 4,  5,  6,   6,  7,  4, // top
+		 8,  9, 10,  10, 11,  8, // back
+		12, 13, 14,  14, 15, 12, // bottom
+		16, 17, 18,  18, 19, 16, // left
+		20, 21, 22,  22, 23, 20  // right
+	};
+	vbo_verticies = createBuffer(GL_ARRAY_BUFFER, verticies, sizeof(verticies));
+	vbo_attribute = createBuffer(GL_ARRAY_BUFFER, cube_texcoords, sizeof(cube_texcoords));
+	ibo_elements = createBuffer(GL_ELEMENT_ARRAY_BUFFER, cube_elements, sizeof(cube_elements));
+	cubeIndexCount = sizeof(cube_elements) / sizeof(GLushort);
+	secondComponents = 2;
+	texturedCube = true;
+
+	cubeProgram = loadProgram("../firstTexture/TexturedCubeShader.vert", "../firstTexture/TexturedCubeShader.frag");
+	if(cubeProgram == 0 || !findAttribute(cubeProgram, "coord3d", attribute_coord3d) ||
+		!findAttribute(cubeProgram, "texcoord", attribute_second)) {
+		return false;
+	}
+	uniform_mvp = glGetUniformLocation(cubeProgram, "mvp");
+
+	glm::vec3 cubeCenter(0.0, 0.0, -4.0);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0, 2.0, 0.0), cubeCenter, glm::vec3(0.0, 1.0, 0.0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+	cubeViewProjection = projection * view;
+	placeCubes(scale, 4.0f);
+	return true;
+}
+
+void renderCubes(float time) {
+	//the demos' tumbling animations, run from the frame number instead of the clock so every run draws the same frames
+	glm::vec3 axisY(0, 1, 0);
+	glm::vec3 axisZ(0, 0, 1);
+	glm::vec3 axisX(1, 0, 0);
+	glm::mat4 animation;
+	if(texturedCube) {
+		float angle = glm::radians(time * 15.0f);
+		animation = glm::rotate(glm::mat4(1.0), angle * 2.0f, axisY) *
+			glm::rotate(glm::mat4(1.0), angle * 3.0f, axisX) *
+			glm::rotate(glm::mat4(1.0), angle * 4.0f, axisZ);
+	} else {
+		float angle = glm::radians(time * 35.0f);
+		animation = glm::rotate(glm::mat4(1.0), angle, axisY) *
+			glm::rotate(glm::mat4(1.0), angle, axisX) *
+			glm::rotate(glm::mat4(1.0), angle, axisZ);
+	}
+
+	glClearColor(0.0, 0.0, 0.0, 1.0);
+	glEnable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glUseProgram(cubeProgram);
+	if(texturedCube) {
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, crateTexture);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
+	glEnableVertexAttribArray(attribute_coord3d);
+	glVertexAttribPointer(attribute_coord3d, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_attribute);
+	glEnableVertexAttribArray(attribute_second);
+	glVertexAttribPointer(attribute_second, secondComponents, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
+
+	for(const glm::mat4 &model : cubeModels) {
+		glm::mat4 mvp = cubeViewProjection * model * animation;
+		glUniformMatrix4fv(uniform_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+		glDrawElements(GL_TRIANGLES, cubeIndexCount, GL_UNSIGNED_SHORT, 0);
+	}
+
+	glDisableVertexAttribArray(attribute_coord3d);
+	glDisableVertexAttribArray(attribute_second);
+	glDisable(GL_DEPTH_TEST);
+}
+
+void freeCubes() {
+	//the shape scenes draw from client side arrays, which only works with no buffers bound
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &vbo_verticies);
+	glDeleteBuffers(1, &vbo_attribute);
+	glDeleteBuffers(1, &ibo_elements);
+	glDeleteTextures(1, &crateTexture);
+	glDeleteProgram(cubeProgram);
+	std::vector<glm::mat4>().swap(cubeModels);
+}
+
+//======
+//SCENES
+//======
+
+struct Scene {
+	const char* name;
+	bool (*init)(int scale);
+	void (*render)(float time);
+	void (*free)();
+	int scale;
+};
+
+Scene scenes[] = {
+	{"triangle", initTriangles, renderShapes, freeShapes, 1},
+	{"quad", initQuads, renderShapes, freeShapes, 1},
+	{"coloredCube", initColoredCubes, renderCubes, freeCubes, 1},
+	{"texturedCube", initTexturedCubes, renderCubes, freeCubes, 1},
+	//stress versions
+	{"triangles-128x128", initTriangles, renderShapes, freeShapes, 128},
+	{"quads-64x64", initQuads, renderShapes, freeShapes, 64},
+	{"coloredCubes-32x32", initColoredCubes, renderCubes, freeCubes, 32},
+	{"texturedCubes-16x16", initTexturedCubes, renderCubes, freeCubes, 16}
+};
+const int SCENE_COUNT = sizeof(scenes) / sizeof(scenes[0]);
+
+//=======
+//METRICS
+//=======
+
+//everything measured for a scene. Lower is better for all of them.
+enum Metric {
+	METRIC_FRAME_MS,        //median time for a whole frame, including glFinish (llvmpipe renders on the CPU)
+	METRIC_SUBMIT_MS,       //median time spent making the frame's GL calls, before glFinish
+	METRIC_DRAW_CALLS,      //per frame
+	METRIC_GL_CALLS,        //per frame, including its glFinish
+	METRIC_HEAP_ALLOCATIONS,//per frame, which should stay at 0
+	METRIC_RESIDENT_KB,     //how much the process grew while the scene was set up and run
+	METRIC_COUNT
+};
+const char* metricNames[METRIC_COUNT] = {"frameMs", "submitMs", "drawCalls", "glCalls", "heapAllocations", "residentKB"};
+//these change with the CPU, the Mesa version and the driver's own allocations
+const bool metricDependsOnMachine[METRIC_COUNT] = {true, true, false, false, false, true};
+
+struct SceneResult {
+	double metrics[METRIC_COUNT];
+	std::vector<unsigned char> pixels; //the golden frame, RGBA, top row first
+};
+
+//a metric regresses if it's more than percent% plus slack worse than the baseline.
+//The slack keeps tiny values, like a 0.2 ms frame, from failing on noise.
+struct Threshold {
+	double percent;
+	double slack;
+};
+
+struct Settings {
+	std::map<std::string, Threshold> thresholds;
+	int channelTolerance = 2;       //a pixel differs from the golden if any channel is further off than this
+	double pixelTolerance = 0.001;  //and the image fails if more than this fraction of its pixels differ
+};
+
+//resident set size from /proc, in KB
+long residentKB() {
+	long pages = 0, resident = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if(statm == nullptr) {
+		return 0;
+	}
+	if(fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+		resident = 0;
+	}
+	fclose(statm);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//the renderer and the CPU it runs on, which the machine dependent metrics are only compared on
+std::string machineName() {
+	std::string cpu = "unknown CPU";
+	std::ifstream cpuinfo("/proc/cpuinfo");
+	std::string line;
+	while(std::getline(cpuinfo, line)) {
+		if(line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+			cpu = line.substr(line.find(':') + 2);
+			break;
+		}
+	}
+	return std::string((const char*)glGetString(GL_RENDERER)) + " on " + cpu + " x" +
+		std::to_string(sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+double median(std::vector<double> &values) {
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+//==========
+//RUN SCENES
+//==========
+
+bool runScene(const Scene &scene, int frames, SceneResult &result) {
+	long residentBefore = residentKB();
+	if(!scene.init(scene.scale)) {
+		std::cerr << scene.name << ": could not be set up\n";
+		return false;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+
+	int frame = 0;
+	for(; frame < WARMUP_FRAMES; frame++) {
+		scene.render(frame * FRAME_TIME);
+		glFinish();
+	}
+
+	//nothing in the measured loop may allocate other than the scene, so the vectors are sized up front
+	std::vector<double> frameTimes(frames), submitTimes(frames);
+	uint64_t allocationsBefore = heapAllocations();
+	uint64_t glCallsBefore = glCalls;
+	uint64_t drawCallsBefore = drawCalls;
+	for(int i = 0; i < frames; i++, frame++) {
+		auto start = std::chrono::steady_clock::now();
+		scene.render(frame * FRAME_TIME);
+		auto submitted = std::chrono::steady_clock::now();
+		glFinish();
+		auto finished = std::chrono::steady_clock::now();
+		submitTimes[i] = std::chrono::duration<double, std::milli>(submitted - start).count();
+		frameTimes[i] = std::chrono::duration<double, std::milli>(finished - start).count();
+	}
+	result.metrics[METRIC_HEAP_ALLOCATIONS] = (double)(heapAllocations() - allocationsBefore) / frames;
+	result.metrics[METRIC_GL_CALLS] = (double)(glCalls - glCallsBefore) / frames;
+	result.metrics[METRIC_DRAW_CALLS] = (double)(drawCalls - drawCallsBefore) / frames;
+	result.metrics[METRIC_FRAME_MS] = median(frameTimes);
+	result.metrics[METRIC_SUBMIT_MS] = median(submitTimes);
+	result.metrics[METRIC_RESIDENT_KB] = std::max(0L, residentKB() - residentBefore);
+
+	//the golden frame is always drawn at the same point in the animation, however many frames were measured
+	scene.render(GOLDEN_TIME);
+	result.pixels.resize(TARGET_SIZE * TARGET_SIZE * 4);
+	std::vector<unsigned char> rows(result.pixels.size());
+	glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+	//GL reads bottom row first, images are stored top row first
+	size_t rowSize = TARGET_SIZE * 4;
+	for(int y = 0; y < TARGET_SIZE; y++) {
+		memcpy(&result.pixels[y * rowSize], &rows[(TARGET_SIZE - 1 - y) * rowSize], rowSize);
+	}
+
+	GLenum error = glGetError();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	scene.free();
+	if(error != GL_NO_ERROR) {
+		std::cerr << scene.name << ": GL error 0x" << std::hex << error << std::dec << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool initFramebuffer() {
+	if(!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object) {
+		std::cerr << "The benchmarks need framebuffer objects (OpenGL 3.0 or ARB_framebuffer_object)\n";
+		return false;
+	}
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TARGET_SIZE, TARGET_SIZE);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if(status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Benchmark framebuffer is incomplete: 0x" << std::hex << status << std::dec << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void freeFramebuffer() {
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+//==================
+//BASELINE & GOLDENS
+//==================
+
+//baseline.txt has a "machine NAME" line saying where it was made, then a "scene metric value" line for each measurement
+bool loadBaseline(const std::string &fileName, std::map<std::string, double> &baseline, std::string &machine) {
+	std::ifstream file(fileName);
+	if(file.fail()) {
+		perror(fileName.c_str());
+		return false;
+	}
+	std::string line;
+	while(std::getline(file, line)) {
+		if(line.empty() || line[0] == '#') {
+			continue;
+		}
+		if(line.compare(0, 8, "machine ") == 0) {
+			machine = line.substr(8);
+			continue;
+		}
+		std::istringstream fields(line);
+		std::string scene, metric;
+		double value;
+		if(fields >> scene >> metric >> value) {
+			baseline[scene + " " + metric] = value;
+		}
+	}
+	return true;
+}
+
+bool saveBaseline(const std::string &fileName, const std::map<std::string, double> &baseline, const std::string &machine) {
+	std::ofstream file(fileName);
+	if(file.fail()) {
+		perror(fileName.c_str());
+		return false;
+	}
+	file << "#scene metric value, written by --update-baseline. frameMs, submitMs and residentKB are only\n";
+	file << "#checked on the machine they were measured on, everything else is checked everywhere.\n";
+	file << "machine " << machine << "\n";
+	for(const auto &entry : baseline) {
+		file << entry.first << " " << entry.second << "\n";
+	}
+	return true;
+}
+
+//thresholds.txt has a "metric percent slack" line for each metric to check, plus the image tolerances
+bool loadSettings(const std::string &fileName, Settings &settings) {
+	std::ifstream file(fileName);
+	if(file.fail()) {
+		perror(fileName.c_str());
+		return false;
+	}
+	std::string line;
+	while(std::getline(file, line)) {
+		if(line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		std::string name;
+		fields >> name;
+		if(name == "imageChannelTolerance") {
+			fields >> settings.channelTolerance;
+		} else if(name == "imagePixelTolerance") {
+			fields >> settings.pixelTolerance;
+		} else {
+			Threshold threshold = {0.0, 0.0};
+			fields >> threshold.percent >> threshold.slack;
+			settings.thresholds[name] = threshold;
+		}
+		if(fields.fail()) {
+			std::cerr << fileName << ": could not read \"" << line << "\"\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool writeImage(const std::string &fileName, const std::vector<unsigned char> &pixels) {
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = TARGET_SIZE;
+	image.height = TARGET_SIZE;
+	image.format = PNG_FORMAT_RGBA;
+	if(!png_image_write_to_file(&image, fileName.c_str(), 0, pixels.data(), 0, NULL)) {
+		std::cerr << fileName << ": " << image.message << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//compare a scene's golden frame against goldens/NAME.png. A failed frame is written to NAME.actual.png
+//in the current directory so it can be looked at, or copied over the golden if the change was intended.
+bool compareImage(const std::string &name, const std::vector<unsigned char> &pixels, const Settings &settings) {
+	std::string goldenFile = "goldens/" + name + ".png";
+	DecodedImage golden;
+	if(!ImageDecoder::decodeFile(goldenFile, golden)) {
+		std::cout << "  " << goldenFile << ": " << golden.error << std::endl;
+		return false;
+	}
+	if(golden.width != TARGET_SIZE || golden.height != TARGET_SIZE) {
+		std::cout << "  " << goldenFile << " is " << golden.width << "x" << golden.height << ", expected " <<
+			TARGET_SIZE << "x" << TARGET_SIZE << std::endl;
+		return false;
+	}
+	int differentPixels = 0, largestDifference = 0;
+	for(size_t i = 0; i < pixels.size(); i += 4) {
+		int difference = 0;
+		for(int channel = 0; channel < 4; channel++) {
+			difference = std::max(difference, std::abs((int)pixels[i + channel] - (int)golden.pixels[i + channel]));
+		}
+		largestDifference = std::max(largestDifference, difference);
+		if(difference > settings.channelTolerance) {
+			differentPixels++;
+		}
+	}
+	double differentFraction = (double)differentPixels / (TARGET_SIZE * TARGET_SIZE);
+	bool passed = differentFraction <= settings.pixelTolerance;
+	std::printf("  %-16s %d pixels differ (%.3f%%), largest difference %d  %s\n", "image", differentPixels,
+		differentFraction * 100.0, largestDifference, passed ? "ok" : "DIFFERENT");
+	if(!passed) {
+		writeImage(name + ".actual.png", pixels);
+	}
+	return passed;
+}
+
+//check each metric against the baseline, returns false if any regressed.
+//Unless the baseline was made on this machine, the machine dependent ones are only reported.
+bool compareMetrics(const std::string &name, const SceneResult &result,
+	const std::map<std::string, double> &baseline, const Settings &settings, bool sameMachine) {
+	bool passed = true;
+	for(int metric = 0; metric < METRIC_COUNT; metric++) {
+		double current = result.metrics[metric];
+		auto stored = baseline.find(name + " " + metricNames[metric]);
+		auto threshold = settings.thresholds.find(metricNames[metric]);
+		if(stored == baseline.end()) {
+			std::printf("  %-16s %12.3f  (no baseline)\n", metricNames[metric], current);
+			continue;
+		}
+		double change = stored->second > 0.0 ? (current / stored->second - 1.0) * 100.0 : 0.0;
+		const char* status = "not checked";
+		if(metricDependsOnMachine[metric] && !sameMachine) {
+			status = "not checked, other machine";
+		} else if(threshold != settings.thresholds.end()) {
+			double limit = stored->second * (1.0 + threshold->second.percent / 100.0) + threshold->second.slack;
+			status = current > limit ? "REGRESSED" : "ok";
+			passed = passed && current <= limit;
+		}
+		std::printf("  %-16s %12.3f  baseline %12.3f  %+7.1f%%  %s\n", metricNames[metric], current,
+			stored->second, change, status);
+	}
+	return passed;
+}
+
+//=====
+//MAIN
+//=====
+
+int main(int argc, char** argv) {
+	//--frames N          measure N frames of each scene (default 60), after 10 warm-up frames
+	//--repeat N          run each scene N times and keep the best timings (default 3)
+	//--scene NAME        only run the scenes whose names start with NAME
+	//--update-baseline   write the measurements to baseline.txt instead of comparing against it
+	//--update-goldens    write the golden frames to goldens/ instead of comparing against them
+	//--baseline FILE     read or write the baseline from FILE instead of baseline.txt
+	//--thresholds FILE   read the tolerances from FILE instead of thresholds.txt
+	int frames = 60;
+	int repeats = 3;
+	std::string sceneFilter;
+	bool updateBaseline = false;
+	bool updateGoldens = false;
+	std::string baselineFile = "baseline.txt";
+	std::string thresholdsFile = "thresholds.txt";
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+			repeats = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+			sceneFilter = argv[++i];
+		} else if(strcmp(argv[i], "--update-baseline") == 0) {
+			updateBaseline = true;
+		} else if(strcmp(argv[i], "--update-goldens") == 0) {
+			updateGoldens = true;
+		} else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baselineFile = argv[++i];
+		} else if(strcmp(argv[i], "--thresholds") == 0 && i + 1 < argc) {
+			thresholdsFile = argv[++i];
+		} else {
+			std::cerr << "Unknown argument: " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	Settings settings;
+	std::map<std::string, double> baseline;
+	std::string baselineMachine;
+	if(!loadSettings(thresholdsFile, settings)) {
+		return 1;
+	}
+	//when updating, scenes that aren't run keep their old numbers
+	if(!loadBaseline(baselineFile, baseline, baselineMachine) && !updateBaseline) {
+		std::cerr << "Run with --update-baseline to create it\n";
+		return 1;
+	}
+
+	//no display needed: SDL's offscreen driver gives a context without a window system, and Mesa is asked
+	//for llvmpipe so the goldens match and the numbers mean the same thing from one run to the next.
+	//Anything already set in the environment wins.
+	SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	SDL_setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+	SDL_setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+	if(SDL_Init(SDL_INIT_VIDEO) != 0) {
+		std::cerr << SDL_GetError() << std::endl;
+		return 1;
+	}
+	SDL_Window* window = SDL_CreateWindow("Benchmarks", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		TARGET_SIZE, TARGET_SIZE, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if(window == nullptr || SDL_GL_CreateContext(window) == nullptr) {
+		std::cerr << SDL_GetError() << std::endl;
+		return 1;
+	}
+	GLenum glewStatus = glewInit();
+	if(glewStatus != GLEW_OK) {
+		std::cerr << "GLEW Error: " << glewGetErrorString(glewStatus) << std::endl;
+		return 1;
+	}
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	std::cout << "Renderer: " << renderer << std::endl;
+	if(strstr(renderer, "llvmpipe") == nullptr) {
+		std::cout << "Warning: not running on llvmpipe, the goldens and baseline were made with it\n";
+	}
+	std::string machine = machineName();
+	bool sameMachine = machine == baselineMachine;
+	if(updateBaseline && !sameMachine) {
+		//the old machine's timings mean nothing next to this one's, even for the scenes that aren't run
+		for(auto entry = baseline.begin(); entry != baseline.end(); ) {
+			std::string metricName = entry->first.substr(entry->first.find(' ') + 1);
+			bool dependsOnMachine = false;
+			for(int metric = 0; metric < METRIC_COUNT; metric++) {
+				if(metricDependsOnMachine[metric] && metricName == metricNames[metric]) {
+					dependsOnMachine = true;
+				}
+			}
+			if(dependsOnMachine) {
+				entry = baseline.erase(entry);
+			} else {
+				++entry;
+			}
+		}
+	} else if(!updateBaseline && !sameMachine) {
+		std::cout << "The baseline was made on " << (baselineMachine.empty() ? "an unknown machine" : baselineMachine) <<
+			",\nso timings and memory are only reported. Run with --update-baseline here to check them too.\n";
+	}
+	if(!initFramebuffer()) {
+		return 1;
+	}
+
+	//llvmpipe starts its threads and grows its caches on the first draws, which would otherwise
+	//be counted against the first scene's memory
+	if(scenes[0].init(scenes[0].scale)) {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		scenes[0].render(0.0f);
+		glFinish();
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		scenes[0].free();
+	}
+
+	bool passed = true;
+	int scenesRun = 0;
+	for(int i = 0; i < SCENE_COUNT; i++) {
+		const Scene &scene = scenes[i];
+		if(strncmp(scene.name, sceneFilter.c_str(), sceneFilter.size()) != 0) {
+			continue;
+		}
+		std::cout << scene.name << std::endl;
+		//the timings are the best of a few runs, each set up from scratch: how fast a frame is can depend on
+		//where the driver happened to put things, and that doesn't change during a run
+		SceneResult result;
+		bool sceneOK = runScene(scene, frames, result);
+		for(int repeat = 1; repeat < repeats && sceneOK; repeat++) {
+			SceneResult again;
+			sceneOK = runScene(scene, frames, again);
+			result.metrics[METRIC_FRAME_MS] = std::min(result.metrics[METRIC_FRAME_MS], again.metrics[METRIC_FRAME_MS]);
+			result.metrics[METRIC_SUBMIT_MS] = std::min(result.metrics[METRIC_SUBMIT_MS], again.metrics[METRIC_SUBMIT_MS]);
+		}
+		if(!sceneOK) {
+			passed = false;
+			continue;
+		}
+		if(updateGoldens) {
+			passed = writeImage("goldens/" + std::string(scene.name) + ".png", result.pixels) && passed;
+		} else {
+			passed = compareImage(scene.name, result.pixels, settings) && passed;
+		}
+		if(updateBaseline) {
+			for(int metric = 0; metric < METRIC_COUNT; metric++) {
+				std::printf("  %-16s %12.3f\n", metricNames[metric], result.metrics[metric]);
+				baseline[std::string(scene.name) + " " + metricNames[metric]] = result.metrics[metric];
+			}
+		} else {
+			passed = compareMetrics(scene.name, result, baseline, settings, sameMachine) && passed;
+		}
+		scenesRun++;
+	}
+	if(scenesRun == 0) {
+		std::cerr << "No scene matches " << sceneFilter << std::endl;
+		passed = false;
+	}
+	if(updateBaseline && scenesRun > 0 && !saveBaseline(baselineFile, baseline, machine)) {
+		passed = false;
+	}
+
+	freeFramebuffer();
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+	std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+	return passed ? 0 : 1;
+}
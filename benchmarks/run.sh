@@ -0,0 +1,14 @@
+#!/bin/sh
+#builds the regression suite and runs it from this directory, passing any arguments along.
+#exits with the suite's status, so it can gate a merge: ./run.sh || echo "performance regression"
+cd "$(dirname "$0")" || exit 1
+#glCalls only counts what GLCounter.h wraps, so every GL function main.cpp calls has to be wrapped there
+unwrapped=$(grep -o 'gl[A-Z][A-Za-z0-9]*(' main.cpp | tr -d '(' | sort -u | while read -r name; do
+	grep -q "^#define $name counted_$name\$" GLCounter.h || echo "$name"
+done)
+if [ -n "$unwrapped" ]; then
+	echo "GLCounter.h doesn't wrap these, so glCalls would miss them:" $unwrapped
+	exit 1
+fi
+g++ -std=c++17 -O2 main.cpp ../firstCube/Allocators.cpp -o regressionSuite -lSDL2 -lGLEW -lGL -lpng -ljpeg -pthread || exit 1
+exec ./regressionSuite "$@"
@@ -0,0 +1,55 @@
+/*
+	Replaces the global operator new/delete so every C++ heap allocation in the program is counted.
+	These have to be defined once per program, so they live here instead of in Allocators.h.
+*/
+
+#include "Allocators.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+//====================
+//ALLOCATION TRACKING
+//====================
+
+static std::atomic<uint64_t> heapAllocationCount(0);
+
+uint64_t heapAllocations() {
+	return heapAllocationCount.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if(void* ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+//over-aligned types (alignas bigger than max_align_t) come through these instead, so they have to be counted too
+void* operator new(size_t size, std::align_val_t alignment) {
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	size_t align = static_cast<size_t>(alignment);
+	//aligned_alloc wants the size to be a multiple of the alignment
+	size_t rounded = ((size ? size : 1) + align - 1) & ~(align - 1);
+	if(void* ptr = std::aligned_alloc(align, rounded)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+	std::free(ptr);
+}
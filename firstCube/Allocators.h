@@ -0,0 +1,96 @@
+/*
+	Allocators for the cube demo, so the main loop doesn't have to touch the heap once it's running.
+
+	FrameArena - linear allocator. Allocating is a pointer bump and everything is freed at once with reset().
+	             Draw items, culling results and other per-frame data come from here.
+
+	There is no object pool. Scene nodes live in SceneGraph's arrays, which are reserved up front, and draw
+	items come from the arena, so nothing in the frame loop is created and destroyed one at a time.
+
+	Allocators.cpp replaces the global operator new/delete to count heap allocations, so the main loop can
+	report how many allocations happen per frame. Build it into the program once, next to main.cpp.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+//====================
+//ALLOCATION TRACKING
+//====================
+
+//total number of operator new calls so far. Take the difference between two calls to count a frame.
+//The counting operator new and delete are in Allocators.cpp.
+uint64_t heapAllocations();
+
+//=============
+//FRAME ARENA
+//=============
+
+class FrameArena {
+public:
+	explicit FrameArena(size_t capacity = 0) {
+		init(capacity);
+	}
+
+	~FrameArena() {
+		std::free(memory);
+	}
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	//grab the backing memory up front. Call this at startup, not from the frame loop.
+	void init(size_t capacity) {
+		std::free(memory);
+		memory = capacity ? static_cast<unsigned char*>(std::malloc(capacity)) : nullptr;
+		size = memory ? capacity : 0;
+		offset = 0;
+	}
+
+	//returns nullptr if the arena is full. The caller decides whether that's fatal.
+	void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+		size_t start = (offset + align - 1) & ~(align - 1);
+		if(start + bytes > size) {
+			overflows++;
+			return nullptr;
+		}
+		offset = start + bytes;
+		if(offset > highWater) {
+			highWater = offset;
+		}
+		return memory + start;
+	}
+
+	//allocate and default construct count objects. Destructors are never run, so only use it for plain data.
+	template<typename T>
+	T* allocate(size_t count) {
+		T* objects = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+		if(objects != nullptr) {
+			for(size_t i = 0; i < count; i++) {
+				new (objects + i) T;
+			}
+		}
+		return objects;
+	}
+
+	//throw away everything allocated since the last reset
+	void reset() {
+		offset = 0;
+	}
+
+	size_t used() const { return offset; }
+	size_t capacity() const { return size; }
+	size_t peak() const { return highWater; }
+	int overflowCount() const { return overflows; }
+
+private:
+	unsigned char* memory = nullptr;
+	size_t size = 0;
+	size_t offset = 0;
+	size_t highWater = 0;
+	int overflows = 0;
+};
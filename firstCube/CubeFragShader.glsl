@@ -1,6 +1,12 @@
 #version 120
 varying vec3 f_color;
+//--shading-work N stands in for an expensive material: N extra iterations of busywork per fragment
+uniform int shadingWork;
 
 void main() {
-	gl_FragColor = vec4(f_color.r, f_color.b, f_color.g, 1.0);
-}
\ No newline at end of file
+	vec3 color = f_color;
+	for(int i = 0; i < shadingWork; i++) {
+		color = fract(color * 1.0001 + sin(color.gbr * 0.001) * 0.00001);
+	}
+	gl_FragColor = vec4(color.r, color.b, color.g, 1.0);
+}
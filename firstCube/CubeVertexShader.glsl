@@ -3,6 +3,8 @@ varying vec3 f_color;
 attribute vec3 coord3d;
 attribute vec3 v_color;
 uniform mat4 mvp;
+//the depth pre-pass draws the same positions with PositionVertexShader.glsl, and the depths have to match exactly
+invariant gl_Position;
 
 void main() {
 	gl_Position = mvp * vec4(coord3d, 1.0);
@@ -0,0 +1,163 @@
+/*
+	Dynamic resolution for the cube demo.
+
+	The scene is drawn into an offscreen framebuffer and stretched onto the window with glBlitFramebuffer.
+	The framebuffer is allocated at the window's size and only the bottom left scale * size of it is drawn into,
+	so changing the scale never reallocates anything; only resizing the window does.
+
+	Every frame is wrapped in a GL_TIME_ELAPSED query. Results are read a few frames later, once the GPU has
+	got to them, so measuring never stalls the pipeline. The cost of a frame goes with its pixel count, which
+	goes with scale squared, so the scale is nudged towards scale * sqrt(target / gpuTime), smoothed so it
+	doesn't oscillate, and clamped between minScale and 1.
+*/
+
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+class DynamicResolution {
+public:
+	//needs framebuffer objects and timer queries. Returns false if they aren't there.
+	bool init(float targetMs, float minScale = 0.5f) {
+		if(!GLEW_ARB_framebuffer_object || !GLEW_ARB_timer_query) {
+			std::cerr << "Dynamic resolution needs ARB_framebuffer_object and ARB_timer_query\n";
+			return false;
+		}
+		targetTime = targetMs;
+		this->minScale = std::min(std::max(minScale, 0.1f), 1.0f);
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+		glGenQueries(QUERY_COUNT, queries);
+		for(int i = 0; i < QUERY_COUNT; i++) {
+			queryPending[i] = false;
+		}
+		return true;
+	}
+
+	//bind the offscreen framebuffer and set the viewport to the scaled size. Call before clearing.
+	void begin(int windowWidth, int windowHeight) {
+		if(windowWidth != width || windowHeight != height) {
+			allocate(windowWidth, windowHeight);
+		}
+		readFinishedQueries();
+
+		renderWidth = std::max(1, (int)(width * currentScale));
+		renderHeight = std::max(1, (int)(height * currentScale));
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, renderWidth, renderHeight);
+		//keep clears inside the part of the framebuffer we use
+		glScissor(0, 0, renderWidth, renderHeight);
+		glEnable(GL_SCISSOR_TEST);
+
+		//if the GPU is so far behind that this query is still in use, this frame just goes unmeasured
+		timing = !queryPending[nextQuery];
+		if(timing) {
+			glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+		}
+	}
+
+	//upscale what was drawn to the window
+	void end() {
+		if(timing) {
+			glEndQuery(GL_TIME_ELAPSED);
+			queryPending[nextQuery] = true;
+			nextQuery = (nextQuery + 1) % QUERY_COUNT;
+		}
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, width, height);
+	}
+
+	void shutdown() {
+		glDeleteQueries(QUERY_COUNT, queries);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+	float scale() const {
+		return currentScale;
+	}
+
+	//GPU time of the most recently measured frame, in milliseconds
+	float gpuTime() const {
+		return lastGpuTime;
+	}
+
+	int renderedWidth() const {
+		return renderWidth;
+	}
+
+	int renderedHeight() const {
+		return renderHeight;
+	}
+
+private:
+	static const int QUERY_COUNT = 4;
+
+	void allocate(int windowWidth, int windowHeight) {
+		width = windowWidth;
+		height = windowHeight;
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		//with stencil, so the overdraw counter works at a reduced resolution too
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cerr << "Dynamic resolution framebuffer is incomplete\n";
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	//pick up every query the GPU has finished, oldest first, and steer the scale with each one
+	void readFinishedQueries() {
+		for(int i = 0; i < QUERY_COUNT; i++) {
+			int query = (nextQuery + i) % QUERY_COUNT;
+			if(!queryPending[query]) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+			if(!available) {
+				break; //later queries can't be done before this one
+			}
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+			queryPending[query] = false;
+			float milliseconds = nanoseconds / 1000000.0f;
+			//some drivers give nonsense for the first query, and no frame really takes a second
+			if(milliseconds > 0.0f && milliseconds < 1000.0f) {
+				lastGpuTime = milliseconds;
+				adjust(milliseconds);
+			}
+		}
+	}
+
+	void adjust(float gpuMs) {
+		float wanted = currentScale * std::sqrt(targetTime / gpuMs);
+		currentScale += (wanted - currentScale) * 0.2f;
+		currentScale = std::min(std::max(currentScale, minScale), 1.0f);
+	}
+
+	GLuint framebuffer = 0, colorBuffer = 0, depthBuffer = 0;
+	GLuint queries[QUERY_COUNT];
+	bool queryPending[QUERY_COUNT];
+	int nextQuery = 0;
+	bool timing = false;
+	int width = 0, height = 0;
+	int renderWidth = 0, renderHeight = 0;
+	float targetTime = 16.0f, minScale = 0.5f;
+	float currentScale = 1.0f;
+	float lastGpuTime = 0.0f;
+};
@@ -0,0 +1,6 @@
+#version 120
+uniform vec4 color;
+
+void main() {
+	gl_FragColor = color;
+}
@@ -0,0 +1,143 @@
+/*
+	A small pool of worker threads for splitting loops across cores.
+
+	parallelFor() cuts [0, count) into batches and hands them out to the workers and the calling thread,
+	returning once every batch is done. The loop body is passed by pointer, so a call doesn't allocate.
+	Only one thread should call parallelFor() at a time.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+
+class JobSystem {
+public:
+	JobSystem() {}
+
+	~JobSystem() {
+		stop();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	//start workerCount threads. 0 means everything runs on the calling thread.
+	void start(int workerCount) {
+		stop();
+		quit = false;
+		for(int i = 0; i < workerCount; i++) {
+			workers.emplace_back(&JobSystem::workerLoop, this);
+		}
+	}
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for(std::thread &worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	//number of threads that work on a parallelFor, including the caller
+	int threadCount() const {
+		return (int)workers.size() + 1;
+	}
+
+	//call body(begin, end) for batches of at most batchSize elements covering [0, count)
+	template<typename F>
+	void parallelFor(size_t count, size_t batchSize, F &&body) {
+		if(batchSize == 0) {
+			batchSize = 1;
+		}
+		if(workers.empty() || count <= batchSize) {
+			body((size_t)0, count);
+			return;
+		}
+		typedef typename std::remove_reference<F>::type Body;
+		Job job;
+		job.function = [](void* context, size_t begin, size_t end) {
+			(*static_cast<Body*>(context))(begin, end);
+		};
+		job.context = (void*)&body;
+		job.count = count;
+		job.batchSize = batchSize;
+		job.next = 0;
+		run(job);
+	}
+
+private:
+	struct Job {
+		void (*function)(void*, size_t, size_t);
+		void* context;
+		size_t count;
+		size_t batchSize;
+		std::atomic<size_t> next;
+	};
+
+	//grab batches until the job runs out of them
+	static void work(Job &job) {
+		while(true) {
+			size_t begin = job.next.fetch_add(job.batchSize);
+			if(begin >= job.count) {
+				return;
+			}
+			size_t end = begin + job.batchSize < job.count ? begin + job.batchSize : job.count;
+			job.function(job.context, begin, end);
+		}
+	}
+
+	void run(Job &job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			current = &job;
+			busy = (int)workers.size();
+			generation++;
+		}
+		wake.notify_all();
+		work(job);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		current = nullptr;
+	}
+
+	void workerLoop() {
+		uint64_t seen = 0;
+		while(true) {
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != seen; });
+			if(quit) {
+				return;
+			}
+			seen = generation;
+			Job* job = current;
+			lock.unlock();
+
+			work(*job);
+
+			lock.lock();
+			if(--busy == 0) {
+				done.notify_one();
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	Job* current = nullptr;
+	uint64_t generation = 0;
+	int busy = 0;
+	bool quit = false;
+};
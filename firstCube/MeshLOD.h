@@ -0,0 +1,309 @@
+/*
+	Level of detail for the cube demo's high-poly meshes.
+
+	simplify() is a quadric error mesh simplifier (Garland and Heckbert). Every vertex gets a quadric that measures
+	the squared distance to the planes of the triangles around it, and the edge whose collapse adds the least error
+	is collapsed first. A vertex always collapses onto the other end of its edge, so every level of detail is just a
+	new index buffer over the original vertices and all the levels can share one vertex buffer. Collapses that
+	would flip a triangle over are skipped.
+
+	buildLodChain() halves the triangle count for each level and records how far (in mesh units) each level may be
+	from the original. The chain is written next to the mesh with saveLodMesh() so it only has to be built once.
+
+	selectLod() picks the coarsest level whose error covers less than a pixel budget on screen, and only drops to a
+	coarser level once it is comfortably under the budget, so objects sitting at a threshold don't pop back and forth.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include <glm/glm.hpp>
+
+const int MAX_LOD_LEVELS = 8;
+
+struct MeshLevel {
+	float error;                   //furthest this level is from the full detail mesh, in mesh units
+	std::vector<uint32_t> indices;
+};
+
+struct LodMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<MeshLevel> levels; //levels[0] is full detail
+};
+
+//symmetric 4x4 matrix, stored as its 10 unique values
+struct Quadric {
+	double a[10] = {};
+
+	static Quadric plane(const glm::vec3 &normal, float d) {
+		Quadric q;
+		double n[4] = {normal.x, normal.y, normal.z, d};
+		int k = 0;
+		for(int i = 0; i < 4; i++) {
+			for(int j = i; j < 4; j++) {
+				q.a[k++] = n[i] * n[j];
+			}
+		}
+		return q;
+	}
+
+	void add(const Quadric &other) {
+		for(int i = 0; i < 10; i++) {
+			a[i] += other.a[i];
+		}
+	}
+
+	//squared distance sum for point p
+	double error(const glm::vec3 &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x + a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y + a[7]*z*z + 2*a[8]*z + a[9];
+	}
+};
+
+//simplify until there are at most targetTriangles left. Returns the new indices and the largest error of any collapse.
+inline std::vector<uint32_t> simplify(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+	size_t targetTriangles, float &maxError) {
+	size_t vertexCount = positions.size();
+	std::vector<uint32_t> triangles(indices);
+	size_t triangleCount = triangles.size() / 3;
+
+	std::vector<Quadric> quadrics(vertexCount);
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	for(size_t t = 0; t < triangleCount; t++) {
+		const glm::vec3 &p0 = positions[triangles[t * 3]];
+		glm::vec3 normal = glm::cross(positions[triangles[t * 3 + 1]] - p0, positions[triangles[t * 3 + 2]] - p0);
+		float length = glm::length(normal);
+		if(length > 0.0f) {
+			normal = normal / length;
+		}
+		Quadric q = Quadric::plane(normal, -glm::dot(normal, p0));
+		for(int v = 0; v < 3; v++) {
+			quadrics[triangles[t * 3 + v]].add(q);
+			vertexTriangles[triangles[t * 3 + v]].push_back((uint32_t)t);
+		}
+	}
+
+	struct Collapse {
+		double cost;
+		uint32_t from, to;
+		uint32_t fromVersion, toVersion;
+		bool operator<(const Collapse &other) const { return cost > other.cost; } //smallest cost on top
+	};
+	std::vector<uint32_t> version(vertexCount, 0);
+	std::vector<bool> removed(vertexCount, false);
+	std::vector<bool> deadTriangle(triangleCount, false);
+	std::priority_queue<Collapse> queue;
+
+	//the cheaper direction of the edge a-b
+	auto pushEdge = [&](uint32_t a, uint32_t b) {
+		Quadric q = quadrics[a];
+		q.add(quadrics[b]);
+		double toB = q.error(positions[b]), toA = q.error(positions[a]);
+		if(toB <= toA) {
+			queue.push(Collapse{toB, a, b, version[a], version[b]});
+		} else {
+			queue.push(Collapse{toA, b, a, version[b], version[a]});
+		}
+	};
+	for(size_t t = 0; t < triangleCount; t++) {
+		for(int e = 0; e < 3; e++) {
+			uint32_t a = triangles[t * 3 + e], b = triangles[t * 3 + (e + 1) % 3];
+			if(a < b) {
+				pushEdge(a, b);
+			}
+		}
+	}
+
+	//would moving from onto to flip or collapse any of from's remaining triangles?
+	auto flips = [&](uint32_t from, uint32_t to) {
+		for(uint32_t t : vertexTriangles[from]) {
+			if(deadTriangle[t]) {
+				continue;
+			}
+			uint32_t* tri = &triangles[t * 3];
+			if(tri[0] == to || tri[1] == to || tri[2] == to) {
+				continue; //this one disappears
+			}
+			glm::vec3 p[3], moved[3];
+			for(int v = 0; v < 3; v++) {
+				p[v] = positions[tri[v]];
+				moved[v] = tri[v] == from ? positions[to] : p[v];
+			}
+			glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+			if(glm::dot(before, after) <= 0.0f) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	maxError = 0.0f;
+	size_t liveTriangles = triangleCount;
+	while(liveTriangles > targetTriangles && !queue.empty()) {
+		Collapse collapse = queue.top();
+		queue.pop();
+		if(removed[collapse.from] || removed[collapse.to] ||
+			version[collapse.from] != collapse.fromVersion || version[collapse.to] != collapse.toVersion) {
+			continue; //stale, a newer entry for this edge is in the queue
+		}
+		if(flips(collapse.from, collapse.to)) {
+			continue;
+		}
+
+		uint32_t from = collapse.from, to = collapse.to;
+		maxError = std::max(maxError, (float)std::sqrt(std::max(collapse.cost, 0.0)));
+		removed[from] = true;
+		quadrics[to].add(quadrics[from]);
+		version[to]++;
+
+		for(uint32_t t : vertexTriangles[from]) {
+			if(deadTriangle[t]) {
+				continue;
+			}
+			uint32_t* tri = &triangles[t * 3];
+			if(tri[0] == to || tri[1] == to || tri[2] == to) {
+				deadTriangle[t] = true;
+				liveTriangles--;
+				continue;
+			}
+			for(int v = 0; v < 3; v++) {
+				if(tri[v] == from) {
+					tri[v] = to;
+				}
+			}
+			vertexTriangles[to].push_back(t);
+		}
+		vertexTriangles[from].clear();
+
+		//only the edges of the merged vertex have new costs. Bumping its version above made their old entries
+		//stale, the neighbours' other edges still have the right cost and stay queued.
+		for(uint32_t t : vertexTriangles[to]) {
+			if(deadTriangle[t]) {
+				continue;
+			}
+			for(int v = 0; v < 3; v++) {
+				uint32_t other = triangles[t * 3 + v];
+				if(other != to) {
+					pushEdge(to, other);
+				}
+			}
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(liveTriangles * 3);
+	for(size_t t = 0; t < triangleCount; t++) {
+		if(!deadTriangle[t]) {
+			result.insert(result.end(), &triangles[t * 3], &triangles[t * 3 + 3]);
+		}
+	}
+	return result;
+}
+
+//full detail plus one level per halving of the triangle count, down to about minTriangles
+inline void buildLodChain(LodMesh &mesh, size_t minTriangles = 64, int maxLevels = MAX_LOD_LEVELS) {
+	mesh.levels.resize(1);
+	mesh.levels[0].error = 0.0f;
+	while((int)mesh.levels.size() < maxLevels) {
+		const MeshLevel &previous = mesh.levels.back();
+		size_t triangles = previous.indices.size() / 3;
+		if(triangles / 2 < minTriangles) {
+			break;
+		}
+		MeshLevel level;
+		float error = 0.0f;
+		level.indices = simplify(mesh.positions, previous.indices, triangles / 2, error);
+		if(level.indices.size() >= previous.indices.size()) {
+			break; //nothing left that can be collapsed safely
+		}
+		//simplify() measures against the level it started from, not the full detail mesh, so the errors of
+		//successive levels add up. The sum is an upper bound on how far this level is from the original.
+		level.error = previous.error + error;
+		mesh.levels.push_back(std::move(level));
+	}
+}
+
+//binary file: "LOD3", vertex count, positions, level count, then error, index count and indices for each level.
+//"LOD1" files stored each level's error as a max instead of a sum, so they are rebuilt.
+inline bool saveLodMesh(const char* fileName, const LodMesh &mesh) {
+	FILE* file = std::fopen(fileName, "wb");
+	if(file == nullptr) {
+		perror(fileName);
+		return false;
+	}
+	uint32_t vertexCount = (uint32_t)mesh.positions.size(), levelCount = (uint32_t)mesh.levels.size();
+	std::fwrite("LOD3", 1, 4, file);
+	std::fwrite(&vertexCount, sizeof(vertexCount), 1, file);
+	std::fwrite(mesh.positions.data(), sizeof(glm::vec3), vertexCount, file);
+	std::fwrite(&levelCount, sizeof(levelCount), 1, file);
+	for(const MeshLevel &level : mesh.levels) {
+		uint32_t indexCount = (uint32_t)level.indices.size();
+		std::fwrite(&level.error, sizeof(level.error), 1, file);
+		std::fwrite(&indexCount, sizeof(indexCount), 1, file);
+		std::fwrite(level.indices.data(), sizeof(uint32_t), indexCount, file);
+	}
+	std::fclose(file);
+	return true;
+}
+
+inline bool loadLodMesh(const char* fileName, LodMesh &mesh) {
+	FILE* file = std::fopen(fileName, "rb");
+	if(file == nullptr) {
+		return false;
+	}
+	char magic[4];
+	uint32_t vertexCount = 0, levelCount = 0;
+	bool ok = std::fread(magic, 1, 4, file) == 4 && std::equal(magic, magic + 4, "LOD3") &&
+		std::fread(&vertexCount, sizeof(vertexCount), 1, file) == 1;
+	if(ok) {
+		mesh.positions.resize(vertexCount);
+		ok = std::fread(mesh.positions.data(), sizeof(glm::vec3), vertexCount, file) == vertexCount &&
+			std::fread(&levelCount, sizeof(levelCount), 1, file) == 1;
+	}
+	ok = ok && levelCount > 0 && levelCount <= (uint32_t)MAX_LOD_LEVELS;
+	mesh.levels.resize(ok ? levelCount : 0);
+	for(uint32_t i = 0; ok && i < levelCount; i++) {
+		uint32_t indexCount = 0;
+		ok = std::fread(&mesh.levels[i].error, sizeof(float), 1, file) == 1 &&
+			std::fread(&indexCount, sizeof(indexCount), 1, file) == 1;
+		if(ok) {
+			mesh.levels[i].indices.resize(indexCount);
+			ok = std::fread(mesh.levels[i].indices.data(), sizeof(uint32_t), indexCount, file) == indexCount &&
+				std::all_of(mesh.levels[i].indices.begin(), mesh.levels[i].indices.end(), [&](uint32_t index) { return index < vertexCount; });
+		}
+	}
+	std::fclose(file);
+	if(!ok) {
+		std::fprintf(stderr, "%s is not a valid LOD mesh\n", fileName);
+	}
+	return ok;
+}
+
+//how many pixels tall an error of worldError looks at distance, for a projection matrix and viewport height.
+//projection[1][1] is 1 / tan(fov / 2), so this works for whatever field of view logic() uses.
+inline float screenSpaceError(float worldError, float distance, const glm::mat4 &projection, int viewportHeight) {
+	return worldError * projection[1][1] * viewportHeight * 0.5f / std::max(distance, 1e-3f);
+}
+
+//pick a level given the one used last frame. A level is good enough when its error is under pixelBudget pixels;
+//we only switch to a coarser level once it is under pixelBudget * hysteresis, so there is a band where we stay put.
+inline int selectLod(const LodMesh &mesh, int current, float scale, float distance, const glm::mat4 &projection,
+	int viewportHeight, float pixelBudget, float hysteresis = 0.75f) {
+	int level = std::min(std::max(current, 0), (int)mesh.levels.size() - 1);
+	//too coarse for this distance: go finer until it fits
+	while(level > 0 && screenSpaceError(mesh.levels[level].error * scale, distance, projection, viewportHeight) > pixelBudget) {
+		level--;
+	}
+	//go coarser while the next level is comfortably inside the budget
+	while(level + 1 < (int)mesh.levels.size() &&
+		screenSpaceError(mesh.levels[level + 1].error * scale, distance, projection, viewportHeight) < pixelBudget * hysteresis) {
+		level++;
+	}
+	return level;
+}
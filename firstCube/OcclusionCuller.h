@@ -0,0 +1,323 @@
+/*
+	Software occlusion culling for the cube demo.
+
+	Big objects close to the camera (occluders) are drawn on the CPU into a small depth buffer. Each occluder is a
+	box, so the rasterizer only has to handle triangles that are completely in front of the camera. It works on
+	four pixels at a time with SSE, and the screen is cut into bands of rows that are filled in parallel.
+	Every triangle writes the depth of its furthest vertex, so the buffer is never nearer than the real scene.
+
+	The depth buffer is then reduced into a pyramid where each texel holds the furthest depth of the four below it.
+	An object's bounding box is hidden if its nearest point is behind the furthest depth of every pyramid texel its
+	screen rectangle touches. Boxes that poke through the near plane are always treated as visible.
+
+	Depth is NDC z mapped to 0 (near) - 1 (far), the same as OpenGL's default depth range.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <glm/glm.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "Allocators.h"
+#include "JobSystem.h"
+
+struct AABB {
+	glm::vec3 min, max;
+};
+
+//what happened to each object in the last testVisibility()
+enum Visibility : uint8_t {
+	VISIBLE,
+	OUTSIDE_FRUSTUM,
+	OCCLUDED
+};
+
+class OcclusionCuller {
+public:
+	//width is rounded up to a multiple of 4 for the SIMD loops
+	void init(int depthWidth, int depthHeight) {
+		width = (depthWidth + 3) & ~3;
+		height = depthHeight;
+		levels.clear();
+		levelWidth.clear();
+		levelHeight.clear();
+		int w = width, h = height;
+		while(true) {
+			levels.push_back(std::vector<float>((size_t)w * h, 1.0f));
+			levelWidth.push_back(w);
+			levelHeight.push_back(h);
+			if(w == 1 && h == 1) {
+				break;
+			}
+			w = (w + 1) / 2;
+			h = (h + 1) / 2;
+		}
+	}
+
+	//draw the occluders into the depth buffer and build the pyramid. Triangle setup goes in arena.
+	void renderOccluders(const glm::mat4 &viewProjection, const AABB* boxes, int count, FrameArena &arena, JobSystem* jobs) {
+		std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+		this->viewProjection = viewProjection;
+
+		//transform and set up every front facing triangle once, then let each band pick the ones it overlaps
+		Triangle* triangles = arena.allocate<Triangle>((size_t)count * 12);
+		if(triangles == nullptr) {
+			//no occluders this frame. Every level has to be cleared to far, not just the first, or the
+			//upper levels would still hold last frame's depths and hide things that are now in view.
+			for(std::vector<float> &level : levels) {
+				std::fill(level.begin(), level.end(), 1.0f);
+			}
+			occluderTriangles = 0;
+			return;
+		}
+		int triangleCount = 0;
+		for(int i = 0; i < count; i++) {
+			triangleCount += setupBox(boxes[i], triangles + triangleCount);
+		}
+		occluderTriangles = triangleCount;
+
+		const int bandHeight = 16;
+		int bands = (height + bandHeight - 1) / bandHeight;
+		auto rasterizeBands = [&](size_t firstBand, size_t lastBand) {
+			for(size_t band = firstBand; band < lastBand; band++) {
+				int top = (int)band * bandHeight;
+				int bottom = std::min(top + bandHeight, height);
+				for(int t = 0; t < triangleCount; t++) {
+					rasterize(triangles[t], top, bottom);
+				}
+			}
+		};
+		if(jobs != nullptr) {
+			jobs->parallelFor(bands, 1, rasterizeBands);
+		} else {
+			rasterizeBands(0, bands);
+		}
+
+		buildPyramid();
+	}
+
+	//classify count boxes against the frustum and the depth pyramid
+	void testVisibility(const AABB* boxes, int count, uint8_t* results, JobSystem* jobs) const {
+		auto testRange = [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; i++) {
+				results[i] = test(boxes[i]);
+			}
+		};
+		if(jobs != nullptr) {
+			jobs->parallelFor(count, 256, testRange);
+		} else {
+			testRange(0, count);
+		}
+	}
+
+	int triangleCount() const {
+		return occluderTriangles;
+	}
+
+private:
+	struct Triangle {
+		float x[3], y[3];
+		float depth; //furthest vertex, so the triangle never claims to be nearer than it is
+		int minX, maxX, minY, maxY;
+	};
+
+	//corners of the box in clip space, returns false if any of them is behind the near plane
+	bool projectCorners(const AABB &box, glm::vec4* clip) const {
+		for(int corner = 0; corner < 8; corner++) {
+			glm::vec4 position(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+				corner & 4 ? box.max.z : box.min.z, 1.0f);
+			clip[corner] = viewProjection * position;
+			if(clip[corner].w <= 1e-4f || clip[corner].z < -clip[corner].w) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int setupBox(const AABB &box, Triangle* out) const {
+		//corner index bits are x, y, z. Each face is two counter-clockwise triangles seen from outside.
+		static const int faces[12][3] = {
+			{4, 5, 7}, {7, 6, 4}, //+z
+			{1, 0, 2}, {2, 3, 1}, //-z
+			{5, 1, 3}, {3, 7, 5}, //+x
+			{0, 4, 6}, {6, 2, 0}, //-x
+			{6, 7, 3}, {3, 2, 6}, //+y
+			{0, 1, 5}, {5, 4, 0}  //-y
+		};
+		glm::vec4 clip[8];
+		if(!projectCorners(box, clip)) {
+			return 0;
+		}
+		float sx[8], sy[8], sz[8];
+		for(int corner = 0; corner < 8; corner++) {
+			float invW = 1.0f / clip[corner].w;
+			sx[corner] = (clip[corner].x * invW * 0.5f + 0.5f) * width;
+			sy[corner] = (clip[corner].y * invW * 0.5f + 0.5f) * height;
+			sz[corner] = clip[corner].z * invW * 0.5f + 0.5f;
+		}
+
+		int count = 0;
+		for(const int* face : faces) {
+			Triangle &triangle = out[count];
+			for(int v = 0; v < 3; v++) {
+				triangle.x[v] = sx[face[v]];
+				triangle.y[v] = sy[face[v]];
+			}
+			float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+				(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+			if(area <= 0.0f) {
+				continue; //facing away, the front faces already cover the box
+			}
+			triangle.depth = std::max(sz[face[0]], std::max(sz[face[1]], sz[face[2]]));
+			triangle.minX = std::max(0, (int)std::floor(std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]))));
+			triangle.maxX = std::min(width - 1, (int)std::ceil(std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]))));
+			triangle.minY = std::max(0, (int)std::floor(std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]))));
+			triangle.maxY = std::min(height - 1, (int)std::ceil(std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]))));
+			if(triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	//fill the pixels whose centres are inside the triangle, for rows top to bottom - 1
+	void rasterize(const Triangle &triangle, int top, int bottom) {
+		int minY = std::max(triangle.minY, top);
+		int maxY = std::min(triangle.maxY, bottom - 1);
+		if(minY > maxY) {
+			return;
+		}
+		//edge i goes from vertex i to vertex i + 1, and is >= 0 on the inside
+		float stepX[3], stepY[3], origin[3];
+		for(int i = 0; i < 3; i++) {
+			int j = (i + 1) % 3;
+			stepX[i] = -(triangle.y[j] - triangle.y[i]);
+			stepY[i] = triangle.x[j] - triangle.x[i];
+			origin[i] = -stepX[i] * triangle.x[i] - stepY[i] * triangle.y[i];
+		}
+		int startX = triangle.minX & ~3;
+		float* depth = levels[0].data();
+
+		for(int y = minY; y <= maxY; y++) {
+			float centerY = y + 0.5f;
+			float* row = depth + (size_t)y * width;
+#if defined(__SSE2__)
+			__m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 triangleDepth = _mm_set1_ps(triangle.depth);
+			__m128 zero = _mm_setzero_ps();
+			__m128 dx[3], edge[3];
+			for(int i = 0; i < 3; i++) {
+				dx[i] = _mm_set1_ps(stepX[i] * 4.0f);
+				__m128 x = _mm_add_ps(_mm_set1_ps((float)startX), lane);
+				edge[i] = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(stepX[i])), _mm_set1_ps(stepY[i] * centerY + origin[i]));
+			}
+			for(int x = startX; x <= triangle.maxX; x += 4) {
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)), _mm_cmpge_ps(edge[2], zero));
+				__m128 current = _mm_load_ps(row + x);
+				__m128 nearer = _mm_min_ps(current, triangleDepth);
+				_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+				for(int i = 0; i < 3; i++) {
+					edge[i] = _mm_add_ps(edge[i], dx[i]);
+				}
+			}
+#else
+			for(int x = startX; x <= triangle.maxX; x++) {
+				float centerX = x + 0.5f;
+				bool inside = true;
+				for(int i = 0; i < 3; i++) {
+					inside = inside && stepX[i] * centerX + stepY[i] * centerY + origin[i] >= 0.0f;
+				}
+				if(inside && triangle.depth < row[x]) {
+					row[x] = triangle.depth;
+				}
+			}
+#endif
+		}
+	}
+
+	//each level keeps the furthest depth of the 2x2 texels below it
+	void buildPyramid() {
+		for(size_t level = 1; level < levels.size(); level++) {
+			const std::vector<float> &source = levels[level - 1];
+			std::vector<float> &target = levels[level];
+			int sourceWidth = levelWidth[level - 1], sourceHeight = levelHeight[level - 1];
+			for(int y = 0; y < levelHeight[level]; y++) {
+				int y0 = y * 2, y1 = std::min(y * 2 + 1, sourceHeight - 1);
+				for(int x = 0; x < levelWidth[level]; x++) {
+					int x0 = x * 2, x1 = std::min(x * 2 + 1, sourceWidth - 1);
+					target[(size_t)y * levelWidth[level] + x] = std::max(
+						std::max(source[(size_t)y0 * sourceWidth + x0], source[(size_t)y0 * sourceWidth + x1]),
+						std::max(source[(size_t)y1 * sourceWidth + x0], source[(size_t)y1 * sourceWidth + x1]));
+				}
+			}
+		}
+	}
+
+	Visibility test(const AABB &box) const {
+		glm::vec4 clip[8];
+		bool inFront = true;
+		for(int corner = 0; corner < 8; corner++) {
+			glm::vec4 position(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+				corner & 4 ? box.max.z : box.min.z, 1.0f);
+			clip[corner] = viewProjection * position;
+			inFront = inFront && clip[corner].w > 1e-4f && clip[corner].z >= -clip[corner].w;
+		}
+
+		//frustum test on the clip space corners: hidden if every corner is outside the same plane
+		for(int axis = 0; axis < 3; axis++) {
+			bool allBelow = true, allAbove = true;
+			for(int corner = 0; corner < 8; corner++) {
+				allBelow = allBelow && clip[corner][axis] < -clip[corner].w;
+				allAbove = allAbove && clip[corner][axis] > clip[corner].w;
+			}
+			if(allBelow || allAbove) {
+				return OUTSIDE_FRUSTUM;
+			}
+		}
+		if(!inFront) {
+			return VISIBLE;
+		}
+
+		float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, nearest = 1.0f;
+		for(int corner = 0; corner < 8; corner++) {
+			float invW = 1.0f / clip[corner].w;
+			float x = (clip[corner].x * invW * 0.5f + 0.5f) * width;
+			float y = (clip[corner].y * invW * 0.5f + 0.5f) * height;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			nearest = std::min(nearest, clip[corner].z * invW * 0.5f + 0.5f);
+		}
+		int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(width - 1, (int)std::floor(maxX));
+		int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(height - 1, (int)std::floor(maxY));
+		if(x0 > x1 || y0 > y1) {
+			return OUTSIDE_FRUSTUM;
+		}
+
+		//go up the pyramid until the rectangle covers at most 2x2 texels
+		size_t level = 0;
+		while(level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+			level++;
+		}
+		const std::vector<float> &depth = levels[level];
+		float furthest = 0.0f;
+		for(int y = y0 >> level; y <= (y1 >> level); y++) {
+			for(int x = x0 >> level; x <= (x1 >> level); x++) {
+				furthest = std::max(furthest, depth[(size_t)y * levelWidth[level] + x]);
+			}
+		}
+		return nearest > furthest ? OCCLUDED : VISIBLE;
+	}
+
+	int width = 0, height = 0;
+	glm::mat4 viewProjection;
+	std::vector<std::vector<float>> levels;
+	std::vector<int> levelWidth, levelHeight;
+	int occluderTriangles = 0;
+};
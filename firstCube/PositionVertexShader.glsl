@@ -0,0 +1,10 @@
+#version 120
+//positions only, for the depth pre-pass and the overdraw heat map
+attribute vec3 coord3d;
+uniform mat4 mvp;
+//must come out bit for bit the same as CubeVertexShader.glsl, or the GL_EQUAL pass after the pre-pass drops pixels
+invariant gl_Position;
+
+void main() {
+	gl_Position = mvp * vec4(coord3d, 1.0);
+}
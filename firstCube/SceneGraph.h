@@ -0,0 +1,186 @@
+/*
+	Transform hierarchy for the cube demo.
+
+	Nodes are stored as separate arrays (parent, local matrix, world matrix, dirty flag) and kept sorted by
+	depth, so every parent comes before its children and all nodes on one level are next to each other.
+	setLocal() only marks a node dirty. update() walks the levels in order, pushes the dirty flag down from
+	parent to child and only rebuilds the world matrix of dirty nodes. Each level is independent of itself,
+	so wide levels are split across the job system.
+
+	Nodes are referred to by NodeId, which stays the same when the arrays are re-sorted.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <atomic>
+#include <glm/glm.hpp>
+#include "JobSystem.h"
+
+typedef int32_t NodeId;
+const NodeId NO_PARENT = -1;
+
+class SceneGraph {
+public:
+	//make sure adding count nodes won't reallocate
+	void reserve(size_t count) {
+		parents.reserve(count);
+		locals.reserve(count);
+		worlds.reserve(count);
+		dirty.reserve(count);
+		depths.reserve(count);
+		indexOf.reserve(count);
+		idAt.reserve(count);
+	}
+
+	//parent has to be an existing node or NO_PARENT
+	NodeId addNode(NodeId parent, const glm::mat4 &local) {
+		NodeId id = (NodeId)indexOf.size();
+		int32_t parentIndex = parent == NO_PARENT ? NO_PARENT : indexOf[parent];
+		parents.push_back(parentIndex);
+		locals.push_back(local);
+		worlds.push_back(local);
+		dirty.push_back(1);
+		depths.push_back(parentIndex == NO_PARENT ? 0 : depths[parentIndex] + 1);
+		indexOf.push_back((int32_t)idAt.size());
+		idAt.push_back(id);
+		anyDirty = true;
+		//appending keeps parents before children, but the levels have to be rebuilt
+		needsSort = true;
+		maxDepth = depths.back() > maxDepth ? depths.back() : maxDepth;
+		return id;
+	}
+
+	void setLocal(NodeId id, const glm::mat4 &local) {
+		int32_t index = indexOf[id];
+		locals[index] = local;
+		dirty[index] = 1;
+		anyDirty = true;
+	}
+
+	const glm::mat4& local(NodeId id) const {
+		return locals[indexOf[id]];
+	}
+
+	//only up to date after update()
+	const glm::mat4& world(NodeId id) const {
+		return worlds[indexOf[id]];
+	}
+
+	size_t size() const {
+		return parents.size();
+	}
+
+	//number of world matrices rebuilt by the last update()
+	size_t lastUpdateCount() const {
+		return updatedCount;
+	}
+
+	//rebuild the world matrices of every dirty node and everything below it.
+	//levels with fewer than parallelThreshold nodes are done on the calling thread.
+	void update(JobSystem* jobs = nullptr, size_t parallelThreshold = 16384) {
+		updatedCount = 0;
+		if(!anyDirty) {
+			return;
+		}
+		if(needsSort) {
+			sortByDepth();
+		}
+
+		std::atomic<size_t> updated(0);
+		for(size_t level = 0; level + 1 < levelStart.size(); level++) {
+			size_t begin = levelStart[level];
+			size_t end = levelStart[level + 1];
+			if(jobs != nullptr && end - begin >= parallelThreshold) {
+				jobs->parallelFor(end - begin, 4096, [&](size_t first, size_t last) {
+					updated += updateRange(begin + first, begin + last);
+				});
+			} else {
+				updated += updateRange(begin, end);
+			}
+		}
+		updatedCount = updated;
+
+		//children read their parent's flag during the walk, so flags are only cleared at the end
+		memset(dirty.data(), 0, dirty.size());
+		anyDirty = false;
+	}
+
+private:
+	size_t updateRange(size_t begin, size_t end) {
+		size_t updated = 0;
+		for(size_t i = begin; i < end; i++) {
+			int32_t parent = parents[i];
+			if(parent == NO_PARENT) {
+				if(dirty[i]) {
+					worlds[i] = locals[i];
+					updated++;
+				}
+			} else if(dirty[i] | dirty[parent]) {
+				dirty[i] = 1;
+				worlds[i] = worlds[parent] * locals[i];
+				updated++;
+			}
+		}
+		return updated;
+	}
+
+	//stable counting sort of every array by depth, then fix up the parent indices and id lookups
+	void sortByDepth() {
+		size_t count = parents.size();
+		levelStart.assign(maxDepth + 2, 0);
+		for(size_t i = 0; i < count; i++) {
+			levelStart[depths[i] + 1]++;
+		}
+		for(size_t level = 1; level < levelStart.size(); level++) {
+			levelStart[level] += levelStart[level - 1];
+		}
+
+		std::vector<int32_t> newIndex(count);
+		std::vector<size_t> cursor(levelStart.begin(), levelStart.end() - 1);
+		for(size_t i = 0; i < count; i++) {
+			newIndex[i] = (int32_t)cursor[depths[i]]++;
+		}
+
+		std::vector<int32_t> sortedParents(count), sortedDepths(count), sortedIds(count);
+		std::vector<glm::mat4> sortedLocals(count), sortedWorlds(count);
+		std::vector<uint8_t> sortedDirty(count);
+		for(size_t i = 0; i < count; i++) {
+			int32_t to = newIndex[i];
+			sortedParents[to] = parents[i] == NO_PARENT ? NO_PARENT : newIndex[parents[i]];
+			sortedDepths[to] = depths[i];
+			sortedIds[to] = idAt[i];
+			sortedLocals[to] = locals[i];
+			sortedWorlds[to] = worlds[i];
+			sortedDirty[to] = dirty[i];
+			indexOf[idAt[i]] = to;
+		}
+		parents.swap(sortedParents);
+		depths.swap(sortedDepths);
+		idAt.swap(sortedIds);
+		locals.swap(sortedLocals);
+		worlds.swap(sortedWorlds);
+		dirty.swap(sortedDirty);
+		needsSort = false;
+	}
+
+	//per node, in depth order
+	std::vector<int32_t> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+	std::vector<int32_t> depths;
+	std::vector<NodeId> idAt;
+
+	//per NodeId
+	std::vector<int32_t> indexOf;
+
+	//levelStart[d] is the index of the first node at depth d, with one extra entry at the end
+	std::vector<size_t> levelStart;
+	int32_t maxDepth = 0;
+	bool needsSort = true;
+	bool anyDirty = false;
+	size_t updatedCount = 0;
+};
@@ -15,6 +15,21 @@
 #include <fstream>
 #include <string.h>
 #include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <climits>
+#include <unordered_map>
+#include "Allocators.h"
+#include "JobSystem.h"
+#include "SceneGraph.h"
+#include "OcclusionCuller.h"
+#include "MeshLOD.h"
+#include "DynamicResolution.h"
 
 //================
 //GLOBAL VARIABLES
@@ -25,24 +40,133 @@ GLuint vbo_verticies, vbo_color;
 GLuint ibo_elements;
 GLint compileOK, linkOK = GL_FALSE;
 
-int screenWidth = 600;
-int screenHeight = 600;
+//window size, changed by the main thread when the window is resized and read by logic() for the aspect ratio
+std::atomic<int> screenWidth(600);
+std::atomic<int> screenHeight(600);
+
+//--dynamic-res draws into an offscreen framebuffer whose resolution follows GPU time (toggle with R)
+DynamicResolution resolution;
+bool dynamicResolution = false;
+float targetFrameTime = 0.0f;
+
+//which vertex and index buffers a draw item uses
+enum MeshType {
+	MESH_CUBE,
+	MESH_LOD
+};
+
+//one thing to draw this frame
+struct DrawItem {
+	glm::mat4 mvp;
+	MeshType mesh;
+	int firstIndex, indexCount;
+};
+
+//everything render() needs to draw one frame, produced by logic()
+struct FrameData {
+	FrameArena arena; //per-frame scratch memory, reset when logic() starts on this frame
+	DrawItem* drawItems;
+	int drawItemCount;
+	Uint64 inputTime; //performance counter value of the input sample this frame was simulated from
+	//culling results, only filled in for the city
+	int objectCount, frustumCulled, occluded;
+	double cullTime;
+	//level of detail results, only filled in for the LOD field
+	int fullDetailTriangles;
+	int levelCounts[MAX_LOD_LEVELS];
+};
+
+//size of each frame's arena. It only has to hold one frame's worth of draw items and scratch data.
+const size_t FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+//print heap allocations per frame along with the frame stats
+bool trackAllocations = false;
+
+//the cube hangs off a static node that places it in front of the camera, and only the spin changes per frame
+JobSystem jobs;
+SceneGraph scene;
+NodeId cubeNode;
+
+//=========
+//CITY MODE
+//=========
+//--city N replaces the cube with an N x N grid of buildings and walks the camera down a street, which is
+//the kind of scene where most objects are hidden behind the ones nearest the camera.
+int citySize = 0;
+const float cityBlock = 12.0f; //8 unit wide buildings with 4 unit streets between them
+std::vector<AABB> buildings;
+std::vector<glm::mat4> buildingModels;
+OcclusionCuller culler;
+std::atomic<bool> occlusionCulling(true);
+//buildings closer than this are drawn into the occlusion buffer
+float occluderRange = 60.0f;
+
+//==============
+//LEVEL OF DETAIL
+//==============
+//--lod-field N draws an N x N field of high-poly meshes and flies the camera over it, picking a level of detail
+//for each one from how big its simplification error would look on screen.
+//like the shaders, the baked LOD chain is read from and written to the working directory, so run the demo from firstCube/
+const char* LOD_MESH_FILE = "BumpySphere.lod";
+int lodFieldSize = 0;
+const float lodSpacing = 5.0f;
+LodMesh lodMesh;
+std::vector<int> lodFirstIndex; //where each level starts in ibo_lod
+std::vector<glm::mat4> lodModels;
+std::vector<int> lodLevels; //level each object used last frame, for the hysteresis
+std::atomic<bool> lodEnabled(true);
+//largest error in pixels we are happy to let through
+float lodPixelError = 1.0f;
+GLuint vbo_lod_verticies, vbo_lod_color, ibo_lod;
+
+//========
+//OVERDRAW
+//========
+//--depth-prepass lays down depth first with positions only and colour writes off, then shades with GL_EQUAL so
+//each pixel runs the fragment shader once (toggle with Z). --front-to-back sorts the draw items nearest first
+//(toggle with F). --overdraw counts the fragments shaded per pixel in the stencil buffer and shows them as a
+//heat map (toggle with V). --shading-work makes the fragment shader expensive enough for any of it to matter.
+GLuint flatProgramID; //positions in, one colour out. Used for the pre-pass and the heat map.
+GLint flat_attribute_coord3d, flat_uniform_mvp, flat_uniform_color;
+GLint uniform_shadingWork;
+std::atomic<bool> depthPrepass(false);
+std::atomic<bool> frontToBack(false);
+bool overdrawView = false;
+int shadingWork = 0;
+//read back from the stencil buffer every frame in overdraw mode
+std::vector<GLubyte> stencilCounts;
+uint64_t shadedFragments = 0, coveredPixels = 0, viewportPixels = 0;
+
+//==============
+//FRAME PIPELINE
+//==============
+//in pipelined mode logic() for frame N+1 runs on a simulation thread while the main thread submits frame N.
+//frames are handed over through a small ring of FrameData slots, maxFramesAhead bounds how far the
+//simulation may run ahead (1 = double buffered, more slots trade latency for throughput).
+const int FRAME_SLOTS = 3;
+FrameData frameSlots[FRAME_SLOTS];
+bool pipelined = false;
+int maxFramesAhead = 1;
+//extra CPU work per frame (number of additional objects simulated) to make the scene CPU-bound
+int simulationWork = 0;
+
+std::thread simThread;
+std::mutex frameMutex;
+std::condition_variable frameCond;
+Uint64 framesSimulated = 0, framesSubmitted = 0;
+bool simQuit = false;
+std::atomic<Uint64> latestInputTime(0);
 
 //load a shader from a file into a string so that openGL can use it.
 void loadShader(const std::string &shaderFile, GLuint id) {
-	std::string line;
-	std::string fileContents = "";
-
-	std::ifstream file;
-	file.open(shaderFile);
+	std::ifstream file(shaderFile, std::ios::binary | std::ios::ate);
 	if(file.fail()) {
 		perror(shaderFile.c_str());
 		exit(1);
 	}
-	//load the shader file
-	while(std::getline(file, line)) {
-		fileContents += line + '\n';
-	}
+	//read the whole file in one go instead of appending it line by line
+	std::string fileContents(file.tellg(), '\0');
+	file.seekg(0);
+	file.read(&fileContents[0], fileContents.size());
 	file.close();
 
 	//compile shader
@@ -64,6 +188,37 @@ void loadShader(const std::string &shaderFile, GLuint id) {
 	}
 }
 
+//the position only program for the depth pre-pass and the overdraw heat map
+bool initFlatProgram() {
+	GLuint vertexID = glCreateShader(GL_VERTEX_SHADER);
+	loadShader("PositionVertexShader.glsl", vertexID);
+	GLuint fragID = glCreateShader(GL_FRAGMENT_SHADER);
+	loadShader("FlatColorFragShader.glsl", fragID);
+
+	flatProgramID = glCreateProgram();
+	glAttachShader(flatProgramID, vertexID);
+	glAttachShader(flatProgramID, fragID);
+	glLinkProgram(flatProgramID);
+	glGetProgramiv(flatProgramID, GL_LINK_STATUS, &linkOK);
+	glDetachShader(flatProgramID, vertexID);
+	glDetachShader(flatProgramID, fragID);
+	glDeleteShader(vertexID);
+	glDeleteShader(fragID);
+	if(!linkOK) {
+		std::cerr << " ERROR: Could not link the flat colour program!\n";
+		return false;
+	}
+
+	flat_attribute_coord3d = glGetAttribLocation(flatProgramID, "coord3d");
+	flat_uniform_mvp = glGetUniformLocation(flatProgramID, "mvp");
+	flat_uniform_color = glGetUniformLocation(flatProgramID, "color");
+	if(flat_attribute_coord3d == -1 || flat_uniform_mvp == -1 || flat_uniform_color == -1) {
+		std::cerr << "Could not bind the flat colour program's inputs\n";
+		return false;
+	}
+	return true;
+}
+
 bool initResources() {
 
 	//VERTICIES
@@ -145,6 +300,28 @@ bool initResources() {
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_color);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(color), color, GL_STATIC_DRAW);
 
+	//all levels share one vertex buffer, and their index buffers are packed one after the other
+	if(lodFieldSize > 0) {
+		std::vector<glm::vec3> lodColors;
+		for(const glm::vec3 &position : lodMesh.positions) {
+			lodColors.push_back(glm::normalize(position) * 0.5f + glm::vec3(0.5f));
+		}
+		std::vector<uint32_t> lodIndices;
+		for(const MeshLevel &level : lodMesh.levels) {
+			lodFirstIndex.push_back((int)lodIndices.size());
+			lodIndices.insert(lodIndices.end(), level.indices.begin(), level.indices.end());
+		}
+		glGenBuffers(1, &vbo_lod_verticies);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_lod_verticies);
+		glBufferData(GL_ARRAY_BUFFER, lodMesh.positions.size() * sizeof(glm::vec3), lodMesh.positions.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &vbo_lod_color);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_lod_color);
+		glBufferData(GL_ARRAY_BUFFER, lodColors.size() * sizeof(glm::vec3), lodColors.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &ibo_lod);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_lod);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, lodIndices.size() * sizeof(uint32_t), lodIndices.data(), GL_STATIC_DRAW);
+	}
+
 
 
 	//=============
@@ -168,6 +345,13 @@ bool initResources() {
 	glAttachShader(programID, fragID);
 	glLinkProgram(programID);
 	glGetProgramiv(programID, GL_LINK_STATUS, &linkOK);
+
+	//the program keeps what it needs, the shader objects can go once it's linked
+	glDetachShader(programID, vertexID);
+	glDetachShader(programID, fragID);
+	glDeleteShader(vertexID);
+	glDeleteShader(fragID);
+
 	if(!linkOK) {
 		std::cerr << " ERROR: Could not link program!\n";
 		return false;
@@ -201,54 +385,256 @@ bool initResources() {
 		std::cerr << "Could not bind uniform: " << uniformName << std::endl;
 		return false;
 	}
+	uniform_shadingWork = glGetUniformLocation(programID, "shadingWork");
 
-	return true;
+	return initFlatProgram();
+}
+
+//draw every draw item, only switching buffers when the mesh changes. v_color is -1 for the position only pass.
+void drawItems(const FrameData &frame, GLint coord3d, GLint v_color, GLint mvp) {
+	glEnableVertexAttribArray(coord3d);
+	if(v_color != -1) {
+		glEnableVertexAttribArray(v_color);
+	}
+	int boundMesh = -1;
+	for(int i = 0; i < frame.drawItemCount; i++) {
+		const DrawItem &item = frame.drawItems[i];
+		if(item.mesh != boundMesh) {
+			bool lod = item.mesh == MESH_LOD;
+			glBindBuffer(GL_ARRAY_BUFFER, lod ? vbo_lod_verticies : vbo_verticies);
+			glVertexAttribPointer(
+			coord3d, //name of attribute
+			3, //number of attributes per vertex (x, y, and z in this case)
+			GL_FLOAT, //type of the attribute
+			GL_FALSE, //take our values as is
+			0, //no extra data between positions
+			0 //offset of first position
+			);
+			if(v_color != -1) {
+				glBindBuffer(GL_ARRAY_BUFFER, lod ? vbo_lod_color : vbo_color);
+				glVertexAttribPointer(v_color, 3, GL_FLOAT, GL_FALSE, 0, 0);
+			}
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod ? ibo_lod : ibo_elements);
+			boundMesh = item.mesh;
+		}
+		//tell OpenGL where the uniform matrix is in the shader. (mvp, in this case)
+		glUniformMatrix4fv(mvp, 1, GL_FALSE, glm::value_ptr(item.mvp));
+		if(item.mesh == MESH_LOD) {
+			glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, (void*)(item.firstIndex * sizeof(GLuint)));
+		} else {
+			glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_SHORT, (void*)(item.firstIndex * sizeof(GLushort)));
+		}
+	}
+	glDisableVertexAttribArray(coord3d);
+	if(v_color != -1) {
+		glDisableVertexAttribArray(v_color);
+	}
+}
+
+//count the fragments the shading pass wrote into the stencil buffer, then colour each pixel by its count:
+//blue for 1, green 2, yellow 3, orange 4, red 5 or more
+void showOverdraw() {
+	//the viewport is the part of the framebuffer drawn into, which is smaller with dynamic resolution
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	stencilCounts.resize((size_t)viewport[2] * viewport[3]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, stencilCounts.data());
+	shadedFragments = coveredPixels = 0;
+	for(GLubyte count : stencilCounts) {
+		shadedFragments += count;
+		coveredPixels += count > 0;
+	}
+	viewportPixels = stencilCounts.size();
+
+	const glm::vec4 heat[5] = {
+		glm::vec4(0.0, 0.0, 1.0, 1.0), glm::vec4(0.0, 1.0, 0.0, 1.0), glm::vec4(1.0, 1.0, 0.0, 1.0),
+		glm::vec4(1.0, 0.5, 0.0, 1.0), glm::vec4(1.0, 0.0, 0.0, 1.0)
+	};
+	//the front face of the cube, flattened onto the screen
+	glm::mat4 fullScreen = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+	glDisable(GL_DEPTH_TEST);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+	glUseProgram(flatProgramID);
+	glUniformMatrix4fv(flat_uniform_mvp, 1, GL_FALSE, glm::value_ptr(fullScreen));
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
+	glEnableVertexAttribArray(flat_attribute_coord3d);
+	glVertexAttribPointer(flat_attribute_coord3d, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
+	for(int level = 1; level <= 5; level++) {
+		//equal for the exact counts, and everything from 5 up for the last one
+		glStencilFunc(level < 5 ? GL_EQUAL : GL_LEQUAL, level, 0xFF);
+		glUniform4fv(flat_uniform_color, 1, glm::value_ptr(heat[level - 1]));
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+	}
+	glDisableVertexAttribArray(flat_attribute_coord3d);
+	glEnable(GL_DEPTH_TEST);
 }
 
-void render(SDL_Window* window) {
+void render(SDL_Window* window, const FrameData &frame) {
 	//wireframe mode - comment the line below to see it filled in
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 	//clear the background to black
 	glClearColor(0.0, 0.0, 0.0, 1.0);
+	if(dynamicResolution) {
+		resolution.begin(screenWidth, screenHeight);
+	}
 
     glEnable(GL_DEPTH_TEST);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glClearStencil(0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | (overdrawView ? GL_STENCIL_BUFFER_BIT : 0));
+
+	if(depthPrepass) {
+		//depth only: no colour writes and no colours sent, so only the cheap part of the pipeline runs
+		glUseProgram(flatProgramID);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		drawItems(frame, flat_attribute_coord3d, -1, flat_uniform_mvp);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		//the nearest depth of every pixel is already there, so only the fragment that made it gets shaded
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	if(overdrawView) {
+		//add one to the pixel's stencil for every fragment that passes the depth test, which is every one shaded
+		glEnable(GL_STENCIL_TEST);
+		glStencilFunc(GL_ALWAYS, 0, 0xFF);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+	}
 
 	glUseProgram(programID);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
-	glEnableVertexAttribArray(attribute_coord3d);
+	glUniform1i(uniform_shadingWork, shadingWork);
+	drawItems(frame, attribute_coord3d, attribute_v_color, uniform_mvp);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
 
-	glVertexAttribPointer(
-	attribute_coord3d, //name of attribute
-	3, //number of attributes per vertex (x, y, and z in this case)
-	GL_FLOAT, //type of the attribute
-	GL_FALSE, //take our values as is
-	0, //no extra data between positions
-	0 //offset of first position
-	);
+	if(overdrawView) {
+		showOverdraw();
+		glDisable(GL_STENCIL_TEST);
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_color);
-	glEnableVertexAttribArray(attribute_v_color);
-	glVertexAttribPointer(attribute_v_color, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	if(dynamicResolution) {
+		resolution.end();
+	}
 
-	//draw the cube
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
-	int bufferSize;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferSize);
-	glDrawElements(GL_TRIANGLES, bufferSize/sizeof(GLushort), GL_UNSIGNED_SHORT, 0);
+	//display the result
+	SDL_GL_SwapWindow(window);
+}
 
+//simulate one frame into frame. This never touches OpenGL so it can run on the simulation thread.
+//walk down the street in the middle of the city, handing render() only the buildings that survive culling
+void cityLogic(FrameData &frame) {
+	float time = SDL_GetTicks() / 1000.0f;
+	float cityLength = citySize * cityBlock;
+	float streetX = (citySize / 2) * cityBlock - cityLength / 2.0f - cityBlock / 2.0f;
+	glm::vec3 eye(streetX, 1.7f, cityLength / 2.0f - std::fmod(time * 8.0f, cityLength));
+	glm::vec3 lookDirection(std::sin(time * 0.3f) * 0.5f, 0.0f, -1.0f);
+	glm::mat4 view = glm::lookAt(eye, eye + lookDirection, glm::vec3(0.0, 1.0, 0.0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f * screenWidth / screenHeight, 0.1f, 500.0f);
+	glm::mat4 viewProjection = projection * view;
 
-	//push each element to the vertex shader (6 because it has to draw 2 triangles to make a square)
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(attribute_coord3d);
-	glDisableVertexAttribArray(attribute_v_color);
+	int count = (int)buildings.size();
+	uint8_t* visibility = frame.arena.allocate<uint8_t>(count);
+	AABB* occluders = frame.arena.allocate<AABB>(count);
+	frame.drawItems = frame.arena.allocate<DrawItem>(count);
+	if(visibility == nullptr || occluders == nullptr || frame.drawItems == nullptr) {
+		return;
+	}
 
-	//display the result
-	SDL_GL_SwapWindow(window);
+	Uint64 start = SDL_GetPerformanceCounter();
+	//with occlusion culling off the depth buffer stays empty, so only the frustum test is left
+	int occluderCount = 0;
+	if(occlusionCulling) {
+		for(int i = 0; i < count; i++) {
+			glm::vec3 center = (buildings[i].min + buildings[i].max) * 0.5f;
+			if(glm::length(center - eye) < occluderRange) {
+				occluders[occluderCount++] = buildings[i];
+			}
+		}
+	}
+	culler.renderOccluders(viewProjection, occluders, occluderCount, frame.arena, &jobs);
+	culler.testVisibility(buildings.data(), count, visibility, &jobs);
+	frame.cullTime = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	frame.objectCount = count;
+	for(int i = 0; i < count; i++) {
+		if(visibility[i] == VISIBLE) {
+			frame.drawItems[frame.drawItemCount++] = DrawItem{viewProjection * buildingModels[i], MESH_CUBE, 0, 36};
+		} else if(visibility[i] == OUTSIDE_FRUSTUM) {
+			frame.frustumCulled++;
+		} else {
+			frame.occluded++;
+		}
+	}
 }
 
-void logic() {
+//fly over the field and give every object the coarsest level whose error is under lodPixelError pixels
+void lodLogic(FrameData &frame) {
+	float time = SDL_GetTicks() / 1000.0f;
+	float fieldLength = lodFieldSize * lodSpacing;
+	//back and forth along the field, so every object goes through all its levels both ways
+	glm::vec3 eye(0.0f, 4.0f, lodSpacing - (0.5f - 0.5f * std::cos(time * 0.2f)) * fieldLength);
+	glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(0.0f, -0.2f, -1.0f), glm::vec3(0.0, 1.0, 0.0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f * screenWidth / screenHeight, 0.1f, 1000.0f);
+	glm::mat4 viewProjection = projection * view;
+
+	int count = (int)lodModels.size();
+	frame.drawItems = frame.arena.allocate<DrawItem>(count);
+	if(frame.drawItems == nullptr) {
+		return;
+	}
+	int fullDetail = (int)lodMesh.levels[0].indices.size() / 3;
+	for(int i = 0; i < count; i++) {
+		const glm::mat4 &model = lodModels[i];
+		float distance = glm::length(glm::vec3(model[3]) - eye);
+		//models are only translated and uniformly scaled, so the length of a column is the scale
+		float scale = glm::length(glm::vec3(model[0]));
+		int level = 0;
+		if(lodEnabled) {
+			level = selectLod(lodMesh, lodLevels[i], scale, distance, projection, screenHeight, lodPixelError);
+		}
+		lodLevels[i] = level;
+		const MeshLevel &mesh = lodMesh.levels[level];
+		frame.drawItems[frame.drawItemCount++] = DrawItem{viewProjection * model, MESH_LOD, lodFirstIndex[level], (int)mesh.indices.size()};
+		frame.fullDetailTriangles += fullDetail;
+		frame.levelCounts[level]++;
+	}
+	frame.objectCount = count;
+}
+
+//nearest first, so the depth test throws hidden fragments away before they are shaded.
+//the clip space w of an object's origin is how far in front of the camera it is.
+void sortDrawItems(FrameData &frame) {
+	if(!frontToBack) {
+		return;
+	}
+	std::sort(frame.drawItems, frame.drawItems + frame.drawItemCount, [](const DrawItem &a, const DrawItem &b) {
+		return a.mvp[3][3] < b.mvp[3][3];
+	});
+}
+
+void logic(FrameData &frame) {
+	frame.arena.reset();
+	frame.drawItems = nullptr;
+	frame.drawItemCount = 0;
+	frame.inputTime = latestInputTime.load();
+	frame.objectCount = frame.frustumCulled = frame.occluded = 0;
+	frame.cullTime = 0.0;
+	frame.fullDetailTriangles = 0;
+	for(int i = 0; i < MAX_LOD_LEVELS; i++) {
+		frame.levelCounts[i] = 0;
+	}
+
+	if(citySize > 0) {
+		cityLogic(frame);
+		sortDrawItems(frame);
+		return;
+	}
+	if(lodFieldSize > 0) {
+		lodLogic(frame);
+		sortDrawItems(frame);
+		return;
+	}
 
 	//rotation animation
 	float angle = SDL_GetTicks() / 1000.0 * 35; //35 degrees per second
@@ -262,49 +648,501 @@ void logic() {
 	glm::rotate(glm::mat4(1.0), glm::radians(angle), axisX) *
 	glm::rotate(glm::mat4(1.0), glm::radians(angle), axisZ);
 
+	//the model matrix is the cube's world transform: its parent's translation times the animation
+	scene.setLocal(cubeNode, animation);
+	scene.update(&jobs);
+	const glm::mat4 &model = scene.world(cubeNode);
+
 	//elements of the mvp matrix
-	glm::mat4 model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0, 0.0, -4.0));
 	glm::mat4 view = glm::lookAt(glm::vec3(0.0, 2.0, 0.0), glm::vec3(0.0, 0.0, -4.0), glm::vec3(0.0, 1.0, 0.0));
 	//project at a 45 degree FOV
 	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f * screenWidth / screenHeight, 0.1f, 10.0f);
 
 	//model view projection matrix, with rotation
-	glm::mat4 mvp = projection * view * model * animation;
+	frame.drawItems = frame.arena.allocate<DrawItem>(1);
+	if(frame.drawItems == nullptr) {
+		return;
+	}
+	frame.drawItems[0] = DrawItem{projection * view * model, MESH_CUBE, 0, 36};
+	frame.drawItemCount = 1;
 
-	glUseProgram(programID);
-	//tell OpenGL where the uniform matrix is in the shader. (mvp, in this case)
-	glUniformMatrix4fv(uniform_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+	//stand-in for a heavier scene: simulate extra objects the same way, using the arena for scratch space
+	glm::mat4* objects = frame.arena.allocate<glm::mat4>(simulationWork);
+	if(objects == nullptr) {
+		return;
+	}
+	glm::mat4 sink(0.0f);
+	for(int i = 0; i < simulationWork; i++) {
+		objects[i] = glm::translate(glm::mat4(1.0f), glm::vec3(i % 32, i / 32 % 32, -4.0 - i / 1024));
+		sink = sink + projection * view * objects[i] * animation;
+	}
+	volatile float keep = sink[0][0];
+	(void)keep;
+}
+
+//simulation thread: keep up to maxFramesAhead frames simulated ahead of the frame being submitted
+void simulationLoop() {
+	while(true) {
+		std::unique_lock<std::mutex> lock(frameMutex);
+		frameCond.wait(lock, [] { return simQuit || framesSimulated - framesSubmitted <= (Uint64)maxFramesAhead; });
+		if(simQuit) {
+			return;
+		}
+		FrameData &frame = frameSlots[framesSimulated % FRAME_SLOTS];
+		lock.unlock();
+
+		//the slot is not visible to the main thread until framesSimulated is bumped
+		logic(frame);
+
+		lock.lock();
+		framesSimulated++;
+		frameCond.notify_all();
+	}
+}
+
+void startSimulation() {
+	framesSimulated = framesSubmitted = 0;
+	simQuit = false;
+	simThread = std::thread(simulationLoop);
+}
+
+void stopSimulation() {
+	if(!simThread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+		simQuit = true;
+	}
+	frameCond.notify_all();
+	simThread.join();
+}
+
+//frame time and input-to-photon latency for the current mode, printed every statsInterval frames
+struct FrameStats {
+	double frameTime = 0.0, latency = 0.0, maxLatency = 0.0;
+	uint64_t heapAllocations = 0;
+	double objects = 0.0, frustumCulled = 0.0, occluded = 0.0, cullTime = 0.0;
+	double triangles = 0.0, fullDetailTriangles = 0.0;
+	double levelCounts[MAX_LOD_LEVELS] = {};
+	double scale = 0.0, gpuTime = 0.0;
+	double shadedFragments = 0.0, coveredPixels = 0.0, viewportPixels = 0.0;
+	int frames = 0;
+};
+
+void reportStats(FrameStats &stats) {
+	const int statsInterval = 120;
+	if(stats.frames < statsInterval) {
+		return;
+	}
+	std::printf("%s (ahead %d, work %d): frame time %.3f ms, input-to-photon %.3f ms avg / %.3f ms max\n",
+		pipelined ? "pipelined" : "sequential", maxFramesAhead, simulationWork,
+		stats.frameTime / stats.frames, stats.latency / stats.frames, stats.maxLatency);
+	if(trackAllocations) {
+		std::printf("  heap allocations: %.2f per frame, frame arena peak %zu / %zu bytes\n",
+			(double)stats.heapAllocations / stats.frames, frameSlots[0].arena.peak(), frameSlots[0].arena.capacity());
+	}
+	if(citySize > 0) {
+		std::printf("  city, occlusion culling %s: %.0f buildings, %.1f%% outside frustum, %.1f%% occluded, culling %.3f ms per frame\n",
+			occlusionCulling ? "on" : "off", stats.objects / stats.frames, 100.0 * stats.frustumCulled / stats.objects,
+			100.0 * stats.occluded / stats.objects, stats.cullTime / stats.frames);
+	}
+	if(dynamicResolution) {
+		float scale = stats.scale / stats.frames;
+		std::printf("  dynamic resolution: %.0f%% scale (%dx%d of %dx%d), GPU %.3f ms for a %.1f ms target\n",
+			scale * 100.0f, (int)(screenWidth * scale), (int)(screenHeight * scale), screenWidth.load(), screenHeight.load(),
+			stats.gpuTime / stats.frames, targetFrameTime);
+	}
+	if(overdrawView) {
+		std::printf("  overdraw: %.2f fragments shaded per covered pixel, %.2f per pixel, %.1f%% of pixels covered (depth pre-pass %s, front to back %s, shading work %d)\n",
+			stats.shadedFragments / std::max(1.0, stats.coveredPixels), stats.shadedFragments / std::max(1.0, stats.viewportPixels),
+			100.0 * stats.coveredPixels / std::max(1.0, stats.viewportPixels), depthPrepass ? "on" : "off", frontToBack ? "on" : "off", shadingWork);
+	}
+	std::printf("  %.0f triangles per frame", stats.triangles / stats.frames);
+	if(lodFieldSize > 0) {
+		std::printf(", %.1f%% of full detail with LOD %s (%.1f px error). Objects per level:",
+			100.0 * stats.triangles / stats.fullDetailTriangles, lodEnabled ? "on" : "off", lodPixelError);
+		for(int i = 0; i < (int)lodMesh.levels.size(); i++) {
+			std::printf(" %.0f", stats.levelCounts[i] / stats.frames);
+		}
+	}
+	std::printf("\n");
+	stats = FrameStats();
+}
+
+//the viewport and aspect ratio follow the window. Frames the simulation already made keep the old aspect ratio.
+//the size comes from the drawable, in pixels: the window event's size is in window coordinates, which differ on HiDPI screens.
+void resize(SDL_Window* window) {
+	int width, height;
+	SDL_GL_GetDrawableSize(window, &width, &height);
+	screenWidth = std::max(1, width);
+	screenHeight = std::max(1, height);
+	glViewport(0, 0, screenWidth, screenHeight);
 }
 
 //loop and process events
 void mainLoop(SDL_Window* window) {
+	const double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+	FrameStats stats;
+	Uint64 lastPresent = SDL_GetPerformanceCounter();
+
+	if(pipelined) {
+		startSimulation();
+	}
+
 	while(true) {
+		uint64_t allocationsBefore = heapAllocations();
 		SDL_Event event;
 		while(SDL_PollEvent(&event)) {
 			if(event.type == SDL_QUIT) {
+				stopSimulation();
 				return;
+			} else if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+				resize(window);
 			} else if(event.type == SDL_KEYDOWN) {
-			//if the end key is pressed, end the program
 				switch(event.key.keysym.sym) {
+					//if the end key is pressed, end the program
 					case SDLK_END:
+					stopSimulation();
 					exit(0);
 					break;
+					//toggle between sequential and pipelined frames
+					case SDLK_p:
+					stopSimulation();
+					pipelined = !pipelined;
+					if(pipelined) {
+						startSimulation();
+					}
+					stats = FrameStats();
+					break;
+					//toggle occlusion culling in the city
+					case SDLK_o:
+					occlusionCulling = !occlusionCulling;
+					stats = FrameStats();
+					break;
+					//toggle level of detail, off draws everything at full detail
+					case SDLK_l:
+					lodEnabled = !lodEnabled;
+					stats = FrameStats();
+					break;
+					//toggle the depth pre-pass, front to back sorting and the overdraw heat map
+					case SDLK_z:
+					depthPrepass = !depthPrepass;
+					stats = FrameStats();
+					break;
+					case SDLK_f:
+					frontToBack = !frontToBack;
+					stats = FrameStats();
+					break;
+					case SDLK_v:
+					overdrawView = !overdrawView;
+					stats = FrameStats();
+					break;
+					//toggle dynamic resolution, if it was set up with --dynamic-res
+					case SDLK_r:
+					if(targetFrameTime > 0.0f) {
+						dynamicResolution = !dynamicResolution;
+						glViewport(0, 0, screenWidth, screenHeight);
+						stats = FrameStats();
+					}
+					break;
+				}
+			}
+		}
+		//input is sampled once per frame, right after the events are drained
+		latestInputTime = SDL_GetPerformanceCounter();
+
+		const FrameData* frame = &frameSlots[0];
+		if(pipelined) {
+			std::unique_lock<std::mutex> lock(frameMutex);
+			frameCond.wait(lock, [] { return framesSimulated > framesSubmitted; });
+			frame = &frameSlots[framesSubmitted % FRAME_SLOTS];
+		} else {
+			logic(frameSlots[0]);
+		}
+
+		render(window, *frame);
+		//the swap returning is as close to photons as we can measure without a display-side timer
+		Uint64 present = SDL_GetPerformanceCounter();
+		double latency = (present - frame->inputTime) * msPerCount;
+		stats.objects += frame->objectCount;
+		stats.frustumCulled += frame->frustumCulled;
+		stats.occluded += frame->occluded;
+		stats.cullTime += frame->cullTime;
+		stats.fullDetailTriangles += frame->fullDetailTriangles;
+		stats.scale += resolution.scale();
+		stats.gpuTime += resolution.gpuTime();
+		if(overdrawView) {
+			stats.shadedFragments += shadedFragments;
+			stats.coveredPixels += coveredPixels;
+			stats.viewportPixels += viewportPixels;
+		}
+		for(int i = 0; i < frame->drawItemCount; i++) {
+			stats.triangles += frame->drawItems[i].indexCount / 3;
+		}
+		for(int i = 0; i < MAX_LOD_LEVELS; i++) {
+			stats.levelCounts[i] += frame->levelCounts[i];
+		}
+
+		if(pipelined) {
+			//release the slot so the simulation thread can reuse it
+			std::lock_guard<std::mutex> lock(frameMutex);
+			framesSubmitted++;
+			frameCond.notify_all();
+		}
+
+		stats.frameTime += (present - lastPresent) * msPerCount;
+		stats.latency += latency;
+		stats.maxLatency = std::max(stats.maxLatency, latency);
+		stats.heapAllocations += heapAllocations() - allocationsBefore;
+		stats.frames++;
+		lastPresent = present;
+		reportStats(stats);
+	}
+}
+
+//build the cube's part of the scene graph
+void initScene() {
+	NodeId placement = scene.addNode(NO_PARENT, glm::translate(glm::mat4(1.0f), glm::vec3(0.0, 0.0, -4.0)));
+	cubeNode = scene.addNode(placement, glm::mat4(1.0f));
+	scene.update(&jobs);
+}
+
+//lay out a grid of boxes with random heights, centred on the origin
+void initCity() {
+	std::mt19937 random(42);
+	float offset = citySize * cityBlock / 2.0f;
+	for(int z = 0; z < citySize; z++) {
+		for(int x = 0; x < citySize; x++) {
+			float height = 4.0f + random() % 27;
+			glm::vec3 center(x * cityBlock - offset, height / 2.0f, z * cityBlock - offset);
+			glm::vec3 halfSize(4.0f, height / 2.0f, 4.0f);
+			buildings.push_back(AABB{center - halfSize, center + halfSize});
+			//the cube mesh goes from -1 to 1, so scaling by the half size makes it fill the box
+			buildingModels.push_back(glm::scale(glm::translate(glm::mat4(1.0f), center), halfSize));
+		}
+	}
+	culler.init(256, 256 * screenHeight / screenWidth);
+}
+
+//a sphere covered in bumps, built from a subdivided cube so the triangles are roughly even.
+//segments quads along each edge of the cube, 12 * segments^2 triangles in total.
+void makeBumpySphere(int segments, LodMesh &mesh) {
+	mesh.positions.clear();
+	mesh.levels.assign(1, MeshLevel());
+	//grid points on the cube's surface are shared between faces, so weld them by their integer coordinates
+	std::unordered_map<int, uint32_t> welded;
+	auto vertex = [&](int x, int y, int z) {
+		int key = (x * (segments + 1) + y) * (segments + 1) + z;
+		auto found = welded.find(key);
+		if(found != welded.end()) {
+			return found->second;
+		}
+		glm::vec3 direction = glm::normalize(glm::vec3(x, y, z) * (2.0f / segments) - glm::vec3(1.0f));
+		float bumps = std::sin(direction.x * 9.0f) * std::sin(direction.y * 9.0f) * std::sin(direction.z * 9.0f);
+		mesh.positions.push_back(direction * (1.0f + 0.1f * bumps));
+		uint32_t index = (uint32_t)mesh.positions.size() - 1;
+		welded[key] = index;
+		return index;
+	};
+
+	std::vector<uint32_t> &indices = mesh.levels[0].indices;
+	for(int axis = 0; axis < 3; axis++) {
+		for(int side = 0; side < 2; side++) {
+			for(int i = 0; i < segments; i++) {
+				for(int j = 0; j < segments; j++) {
+					uint32_t corners[4];
+					const int offsets[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+					for(int c = 0; c < 4; c++) {
+						int point[3];
+						point[axis] = side * segments;
+						point[(axis + 1) % 3] = i + offsets[c][0];
+						point[(axis + 2) % 3] = j + offsets[c][1];
+						corners[c] = vertex(point[0], point[1], point[2]);
+					}
+					//the winding flips with the side of the cube
+					if(side == 1) {
+						indices.insert(indices.end(), {corners[0], corners[1], corners[2], corners[2], corners[3], corners[0]});
+					} else {
+						indices.insert(indices.end(), {corners[0], corners[2], corners[1], corners[2], corners[0], corners[3]});
+					}
 				}
 			}
 		}
-		logic();
-		render(window);
+	}
+}
+
+//load the LOD mesh, simplifying and saving it first if it hasn't been built yet
+bool loadLods(bool rebuild) {
+	if(!rebuild && loadLodMesh(LOD_MESH_FILE, lodMesh)) {
+		return true;
+	}
+	auto start = std::chrono::steady_clock::now();
+	makeBumpySphere(96, lodMesh);
+	buildLodChain(lodMesh);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("built %zu levels of detail in %.2f s:\n", lodMesh.levels.size(), seconds);
+	for(size_t i = 0; i < lodMesh.levels.size(); i++) {
+		std::printf("  level %zu: %7zu triangles, error %.5f\n", i, lodMesh.levels[i].indices.size() / 3, lodMesh.levels[i].error);
+	}
+	if(!saveLodMesh(LOD_MESH_FILE, lodMesh)) {
+		return false;
+	}
+	char path[PATH_MAX];
+	std::printf("saved to %s\n", realpath(LOD_MESH_FILE, path) != nullptr ? path : LOD_MESH_FILE);
+	return true;
+}
+
+//lay out the LOD field, one object every lodSpacing units going away from the camera
+void initLodField() {
+	float offset = (lodFieldSize - 1) * lodSpacing / 2.0f;
+	for(int z = 0; z < lodFieldSize; z++) {
+		for(int x = 0; x < lodFieldSize; x++) {
+			glm::vec3 position(x * lodSpacing - offset, 1.5f, -z * lodSpacing);
+			lodModels.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(1.5f)));
+		}
+	}
+	lodLevels.assign(lodModels.size(), 0);
+}
+
+//time scene graph updates with nodeCount nodes and different fractions of them moving each frame
+void benchmarkSceneGraph(int nodeCount) {
+	std::mt19937 random(1234);
+	SceneGraph graph;
+	graph.reserve(nodeCount);
+	//random parent among the earlier nodes gives a wide tree, roughly log(n) levels deep
+	std::vector<NodeId> nodes;
+	nodes.reserve(nodeCount);
+	for(int i = 0; i < nodeCount; i++) {
+		NodeId parent = i == 0 ? NO_PARENT : nodes[random() % i];
+		glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(random() % 100 / 100.0f, 0.0f, 0.0f));
+		nodes.push_back(graph.addNode(parent, local));
+	}
+	graph.update(&jobs);
+
+	const double fractions[] = {0.01, 0.1, 1.0};
+	const int frames = 20;
+	std::printf("scene graph: %d nodes, %d threads\n", nodeCount, jobs.threadCount());
+	for(double fraction : fractions) {
+		int moving = std::max(1, (int)(nodeCount * fraction));
+		for(int threaded = 0; threaded < 2; threaded++) {
+			double total = 0.0;
+			size_t updated = 0;
+			for(int frame = 0; frame < frames; frame++) {
+				for(int i = 0; i < moving; i++) {
+					NodeId node = fraction < 1.0 ? nodes[random() % nodeCount] : nodes[i];
+					graph.setLocal(node, glm::rotate(graph.local(node), 0.01f, glm::vec3(0.0, 1.0, 0.0)));
+				}
+				auto start = std::chrono::steady_clock::now();
+				graph.update(threaded ? &jobs : nullptr);
+				total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				updated += graph.lastUpdateCount();
+			}
+			std::printf("  %5.1f%% dirty, %s: %.3f ms per update, %zu world matrices rebuilt\n",
+				fraction * 100.0, threaded ? "threaded" : "single thread", total / frames, updated / frames);
+		}
 	}
 }
 
 //clean up used memory
 void freeResources() {
 	glDeleteProgram(programID);
+	glDeleteProgram(flatProgramID);
 	glDeleteBuffers(1, &vbo_verticies);
+	glDeleteBuffers(1, &vbo_color);
+	glDeleteBuffers(1, &ibo_elements);
+	if(targetFrameTime > 0.0f) {
+		resolution.shutdown();
+	}
+	if(lodFieldSize > 0) {
+		glDeleteBuffers(1, &vbo_lod_verticies);
+		glDeleteBuffers(1, &vbo_lod_color);
+		glDeleteBuffers(1, &ibo_lod);
+	}
 }
 
-int main() {
+int main(int argc, char** argv) {
+	//--pipelined           start in pipelined mode (toggle at runtime with P)
+	//--frames-ahead N      how many frames the simulation may run ahead, 1 to FRAME_SLOTS - 1
+	//--sim-work N          simulate N extra objects per frame to make the scene CPU-bound
+	//--track-allocs        report heap allocations per frame, which should be 0 once the loop is running
+	//--scene-bench N       time scene graph updates with N nodes and exit
+	//--city N              draw an N x N city with occlusion culling (toggle with O) instead of the cube
+	//--no-occlusion        start the city with only frustum culling
+	//--lod-field N         draw an N x N field of high-poly meshes with level of detail (toggle with L)
+	//--lod-error PX        largest simplification error allowed on screen, in pixels (default 1)
+	//--bake-lods           rebuild the level of detail chain in BumpySphere.lod (in the working directory) and exit
+	//--dynamic-res MS      lower the render resolution as needed to keep GPU time under MS milliseconds (toggle with R)
+	//--depth-prepass       draw depth first, then shade only the visible fragments (toggle with Z)
+	//--front-to-back       sort draw items nearest first (toggle with F)
+	//--overdraw            count fragments shaded per pixel and show them as a heat map (toggle with V)
+	//--shading-work N      add N iterations of busywork to the fragment shader
+	int sceneBenchNodes = 0;
+	bool bakeLods = false;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--pipelined") == 0) {
+			pipelined = true;
+		} else if(strcmp(argv[i], "--frames-ahead") == 0 && i + 1 < argc) {
+			maxFramesAhead = std::max(1, std::min(FRAME_SLOTS - 1, atoi(argv[++i])));
+		} else if(strcmp(argv[i], "--sim-work") == 0 && i + 1 < argc) {
+			simulationWork = std::max(0, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--track-allocs") == 0) {
+			trackAllocations = true;
+		} else if(strcmp(argv[i], "--scene-bench") == 0 && i + 1 < argc) {
+			sceneBenchNodes = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--city") == 0 && i + 1 < argc) {
+			citySize = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--no-occlusion") == 0) {
+			occlusionCulling = false;
+		} else if(strcmp(argv[i], "--lod-field") == 0 && i + 1 < argc) {
+			lodFieldSize = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--lod-error") == 0 && i + 1 < argc) {
+			lodPixelError = std::max(0.01f, (float)atof(argv[++i]));
+		} else if(strcmp(argv[i], "--bake-lods") == 0) {
+			bakeLods = true;
+		} else if(strcmp(argv[i], "--dynamic-res") == 0 && i + 1 < argc) {
+			targetFrameTime = std::max(1.0f, (float)atof(argv[++i]));
+		} else if(strcmp(argv[i], "--depth-prepass") == 0) {
+			depthPrepass = true;
+		} else if(strcmp(argv[i], "--front-to-back") == 0) {
+			frontToBack = true;
+		} else if(strcmp(argv[i], "--overdraw") == 0) {
+			overdrawView = true;
+		} else if(strcmp(argv[i], "--shading-work") == 0 && i + 1 < argc) {
+			shadingWork = std::max(0, atoi(argv[++i]));
+		}
+	}
+
+	jobs.start(std::max(1, (int)std::thread::hardware_concurrency()) - 1);
+	if(sceneBenchNodes > 0) {
+		benchmarkSceneGraph(sceneBenchNodes);
+		return 0;
+	}
+	if(bakeLods) {
+		return loadLods(true) ? 0 : 1;
+	}
+	initScene();
+	if(citySize > 0) {
+		initCity();
+	} else if(lodFieldSize > 0) {
+		if(!loadLods(false)) {
+			exit(1);
+		}
+		initLodField();
+	}
+
+	//room for the extra simulated objects, the city's draw items, culling results and occluder triangles,
+	//and the LOD field's draw items
+	size_t arenaSize = FRAME_ARENA_SIZE + simulationWork * sizeof(glm::mat4) + buildings.size() * 1024 +
+		lodModels.size() * sizeof(DrawItem);
+	for(int i = 0; i < FRAME_SLOTS; i++) {
+		frameSlots[i].arena.init(arenaSize);
+	}
+
+
 	SDL_Init(SDL_INIT_EVERYTHING);
+	//the overdraw counter needs a stencil buffer
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 	SDL_Window* window = SDL_CreateWindow("First Cube", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, screenWidth, screenHeight, SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL);
 	SDL_GL_CreateContext(window);
 
@@ -322,6 +1160,14 @@ int main() {
 		std::cerr << "initResources failed!\n";
 		exit(1);
 	}
+	if(targetFrameTime > 0.0f) {
+		if(!resolution.init(targetFrameTime)) {
+			exit(1);
+		}
+		dynamicResolution = true;
+	}
+	//the window may not have been given the size we asked for
+	resize(window);
 
 
 	mainLoop(window);
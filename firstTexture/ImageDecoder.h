@@ -0,0 +1,450 @@
+/*
+	Decodes PNG and JPEG files into tightly packed 8 bit RGBA (or BGRA) without going through SDL_image.
+
+	Decoding is split in two. open() reads the whole file into memory and parses just enough of the header to know
+	the image's size, so the caller can work out where every image goes before any of them is decoded. decode()
+	then writes the pixels straight into whatever memory it is given, a row at a time: a std::vector, or a mapped
+	pixel buffer object, so the pixels are never copied again before glTexImage2D. Each row goes through the
+	optional red/blue swap and alpha premultiply while it's still in cache, four pixels at a time with SSE2.
+
+	PNGs go through libpng's row reader and JPEGs through libjpeg, asking libjpeg-turbo for RGBA directly when it
+	can. Neither library keeps global state, so decodeAll() and uploadAll() decode one image per job on the job
+	system. Only the calling thread touches OpenGL.
+*/
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdio>
+#include <cstring>
+#include <csetjmp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <libpng/png.h>
+#include <jpeglib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "../firstCube/JobSystem.h"
+
+enum DecodeFlags : unsigned {
+	DECODE_BGRA = 1 << 0,        //swap red and blue, for uploading as GL_BGRA
+	DECODE_PREMULTIPLY = 1 << 1  //multiply red, green and blue by alpha
+};
+
+enum ImageFormat {
+	IMAGE_UNKNOWN,
+	IMAGE_PNG,
+	IMAGE_JPEG
+};
+
+//a file read into memory, with its size parsed from the header
+struct EncodedImage {
+	std::string file;
+	std::vector<unsigned char> data;
+	ImageFormat format = IMAGE_UNKNOWN;
+	int width = 0, height = 0;
+	std::string error; //why open() or decode() failed
+
+	size_t decodedBytes() const {
+		return (size_t)width * height * 4;
+	}
+};
+
+struct DecodedImage {
+	int width = 0, height = 0;
+	std::vector<unsigned char> pixels; //width * height * 4 bytes, rows top to bottom
+	std::string error;
+};
+
+class ImageDecoder {
+public:
+	ImageDecoder(JobSystem &jobs) : jobs(jobs) {}
+
+	//read a file and its header. Returns false (with image.error set) if it can't be read or isn't a PNG or JPEG.
+	static bool open(const std::string &file, EncodedImage &image) {
+		image.file = file;
+		std::ifstream stream(file, std::ios::binary | std::ios::ate);
+		if(stream.fail()) {
+			image.error = "can't open file";
+			return false;
+		}
+		image.data.resize(stream.tellg());
+		stream.seekg(0);
+		stream.read((char*)image.data.data(), image.data.size());
+		if(stream.fail()) {
+			image.error = "can't read file";
+			return false;
+		}
+
+		const unsigned char* data = image.data.data();
+		size_t size = image.data.size();
+		if(size >= 24 && png_sig_cmp(data, 0, 8) == 0 && memcmp(data + 12, "IHDR", 4) == 0) {
+			//the first chunk is always IHDR, which starts with the width and height, big endian
+			image.format = IMAGE_PNG;
+			image.width = (int)readBigEndian(data + 16);
+			image.height = (int)readBigEndian(data + 20);
+		} else if(size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+			image.format = IMAGE_JPEG;
+			if(!readJpegSize(image)) {
+				return false;
+			}
+		} else {
+			image.error = "not a PNG or JPEG";
+			return false;
+		}
+		if(image.width <= 0 || image.height <= 0 || image.width > 65536 || image.height > 65536) {
+			image.error = "bad image size";
+			return false;
+		}
+		return true;
+	}
+
+	//decode an opened image into pixels, rows stride bytes apart (at least width * 4)
+	static bool decode(EncodedImage &image, unsigned char* pixels, size_t stride, unsigned flags = 0) {
+		if(image.format == IMAGE_PNG) {
+			return decodePng(image, pixels, stride, flags);
+		} else if(image.format == IMAGE_JPEG) {
+			return decodeJpeg(image, pixels, stride, flags);
+		}
+		image.error = "not opened";
+		return false;
+	}
+
+	//open and decode a file into image
+	static bool decodeFile(const std::string &file, DecodedImage &image, unsigned flags = 0) {
+		EncodedImage encoded;
+		bool ok = open(file, encoded);
+		if(ok) {
+			image.width = encoded.width;
+			image.height = encoded.height;
+			image.pixels.resize(encoded.decodedBytes());
+			ok = decode(encoded, image.pixels.data(), (size_t)encoded.width * 4, flags);
+		}
+		if(!ok) {
+			image.pixels.clear();
+			image.error = encoded.error;
+		}
+		return ok;
+	}
+
+	//decode every file in parallel, images[i] from files[i]. Returns false if any failed, after printing why.
+	bool decodeAll(const std::vector<std::string> &files, std::vector<DecodedImage> &images, unsigned flags = 0) {
+		images.assign(files.size(), DecodedImage());
+		jobs.parallelFor(files.size(), 1, [&](size_t begin, size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				decodeFile(files[i], images[i], flags);
+			}
+		});
+		bool ok = true;
+		for(size_t i = 0; i < files.size(); i++) {
+			if(!images[i].error.empty()) {
+				std::cerr << files[i] << ": " << images[i].error << std::endl;
+				ok = false;
+			}
+		}
+		return ok;
+	}
+
+	//decode every file in parallel straight into one mapped pixel buffer object, then create a texture for each
+	//from it. textures[i] is 0 for files that failed. Returns false if any failed, after printing why.
+	bool uploadAll(const std::vector<std::string> &files, std::vector<GLuint> &textures, unsigned flags = 0) {
+		textures.assign(files.size(), 0);
+		std::vector<EncodedImage> images(files.size());
+		jobs.parallelFor(files.size(), 1, [&](size_t begin, size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				open(files[i], images[i]);
+			}
+		});
+
+		//every image's place in the buffer is known before anything is decoded
+		std::vector<size_t> offsets(files.size(), 0);
+		size_t totalBytes = 0;
+		for(size_t i = 0; i < images.size(); i++) {
+			if(images[i].error.empty()) {
+				offsets[i] = totalBytes;
+				totalBytes += images[i].decodedBytes();
+			}
+		}
+
+		std::vector<unsigned char> fallback;
+		unsigned char* mapped = nullptr;
+		GLuint pixelBuffer = 0;
+		if(totalBytes > 0 && GLEW_ARB_pixel_buffer_object) {
+			glGenBuffers(1, &pixelBuffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+			if(GLEW_ARB_map_buffer_range) {
+				mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, totalBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			} else {
+				mapped = (unsigned char*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+			}
+			if(mapped == nullptr) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glDeleteBuffers(1, &pixelBuffer);
+				pixelBuffer = 0;
+			}
+		}
+		if(mapped == nullptr) {
+			//no pixel buffers, decode into system memory and upload from there
+			fallback.resize(totalBytes);
+			mapped = fallback.data();
+		}
+
+		jobs.parallelFor(files.size(), 1, [&](size_t begin, size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				if(images[i].error.empty()) {
+					decode(images[i], mapped + offsets[i], (size_t)images[i].width * 4, flags);
+				}
+			}
+		});
+
+		//with a buffer bound, the pixel pointers below are offsets into it
+		const unsigned char* source = mapped;
+		if(pixelBuffer != 0) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			source = nullptr;
+		}
+		GLenum format = (flags & DECODE_BGRA) ? GL_BGRA : GL_RGBA;
+		bool ok = true;
+		for(size_t i = 0; i < images.size(); i++) {
+			if(!images[i].error.empty()) {
+				std::cerr << files[i] << ": " << images[i].error << std::endl;
+				ok = false;
+				continue;
+			}
+			glGenTextures(1, &textures[i]);
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, images[i].width, images[i].height, 0, format, GL_UNSIGNED_BYTE, source + offsets[i]);
+		}
+		if(pixelBuffer != 0) {
+			//the driver keeps the storage alive until the copies out of it are done
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &pixelBuffer);
+		}
+		return ok;
+	}
+
+	//swap red and blue and/or premultiply count RGBA pixels in place
+	static void finishPixels(unsigned char* pixels, size_t count, unsigned flags) {
+		if(flags == 0) {
+			return;
+		}
+		size_t i = 0;
+#if defined(__SSE2__)
+		const __m128i greenAlpha = _mm_set1_epi32((int)0xFF00FF00);
+		const __m128i redBlue = _mm_set1_epi32(0x00FF00FF);
+		//the alpha lanes of two pixels widened to 16 bits
+		const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+		const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+		const __m128i zero = _mm_setzero_si128();
+		for(; i + 4 <= count; i += 4) {
+			__m128i* address = reinterpret_cast<__m128i*>(pixels + i * 4);
+			__m128i p = _mm_loadu_si128(address);
+			if(flags & DECODE_BGRA) {
+				__m128i rb = _mm_and_si128(p, redBlue);
+				p = _mm_or_si128(_mm_and_si128(p, greenAlpha), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+			}
+			if(flags & DECODE_PREMULTIPLY) {
+				__m128i low = _mm_unpacklo_epi8(p, zero);
+				__m128i high = _mm_unpackhi_epi8(p, zero);
+				//each pixel's alpha in all four of its lanes, except alpha itself is multiplied by 255 so it stays put
+				__m128i alphaLow = _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				__m128i alphaHigh = _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				alphaLow = _mm_or_si128(_mm_andnot_si128(alphaLanes, alphaLow), alphaOne);
+				alphaHigh = _mm_or_si128(_mm_andnot_si128(alphaLanes, alphaHigh), alphaOne);
+				low = divideBy255(_mm_mullo_epi16(low, alphaLow));
+				high = divideBy255(_mm_mullo_epi16(high, alphaHigh));
+				p = _mm_packus_epi16(low, high);
+			}
+			_mm_storeu_si128(address, p);
+		}
+#endif
+		for(; i < count; i++) {
+			unsigned char* pixel = pixels + i * 4;
+			if(flags & DECODE_BGRA) {
+				std::swap(pixel[0], pixel[2]);
+			}
+			if(flags & DECODE_PREMULTIPLY) {
+				for(int c = 0; c < 3; c++) {
+					unsigned value = pixel[c] * pixel[3] + 128;
+					pixel[c] = (unsigned char)((value + (value >> 8)) >> 8);
+				}
+			}
+		}
+	}
+
+private:
+	static uint32_t readBigEndian(const unsigned char* bytes) {
+		return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+	}
+
+#if defined(__SSE2__)
+	//x / 255 rounded, exact for every product of two bytes
+	static __m128i divideBy255(__m128i x) {
+		x = _mm_add_epi16(x, _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+	}
+#endif
+
+	//===
+	//PNG
+	//===
+
+	struct PngSource {
+		const unsigned char* data;
+		size_t size, position;
+	};
+
+	static void readPng(png_structp png, png_bytep out, png_size_t length) {
+		PngSource* source = static_cast<PngSource*>(png_get_io_ptr(png));
+		if(length > source->size - source->position) {
+			png_error(png, "file is truncated");
+		}
+		memcpy(out, source->data + source->position, length);
+		source->position += length;
+	}
+
+	static void pngError(png_structp png, png_const_charp message) {
+		std::string* error = static_cast<std::string*>(png_get_error_ptr(png));
+		*error = message;
+		png_longjmp(png, 1);
+	}
+
+	static void pngWarning(png_structp, png_const_charp) {}
+
+	static bool decodePng(EncodedImage &image, unsigned char* pixels, size_t stride, unsigned flags) {
+		png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &image.error, pngError, pngWarning);
+		png_infop info = png ? png_create_info_struct(png) : nullptr;
+		if(info == nullptr) {
+			png_destroy_read_struct(&png, nullptr, nullptr);
+			image.error = "out of memory";
+			return false;
+		}
+		PngSource source = {image.data.data(), image.data.size(), 0};
+		//libpng jumps back here when it hits an error
+		if(setjmp(png_jmpbuf(png))) {
+			png_destroy_read_struct(&png, &info, nullptr);
+			return false;
+		}
+		png_set_read_fn(png, &source, readPng);
+		png_read_info(png, info);
+
+		//whatever the file holds, ask for 8 bits of red, green, blue and alpha
+		png_set_expand(png);
+		png_set_strip_16(png);
+		png_set_gray_to_rgb(png);
+		png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+		int passes = png_set_interlace_handling(png);
+		png_read_update_info(png, info);
+		if(png_get_image_width(png, info) != (png_uint_32)image.width || png_get_image_height(png, info) != (png_uint_32)image.height ||
+			png_get_rowbytes(png, info) != (size_t)image.width * 4) {
+			png_error(png, "unexpected pixel layout");
+		}
+
+		//interlaced images fill each row in over several passes, so rows are only finished on the last one
+		for(int pass = 0; pass < passes; pass++) {
+			for(int y = 0; y < image.height; y++) {
+				unsigned char* row = pixels + y * stride;
+				png_read_row(png, row, nullptr);
+				if(pass == passes - 1) {
+					finishPixels(row, image.width, flags);
+				}
+			}
+		}
+		png_read_end(png, nullptr);
+		png_destroy_read_struct(&png, &info, nullptr);
+		return true;
+	}
+
+	//====
+	//JPEG
+	//====
+
+	struct JpegError {
+		jpeg_error_mgr manager;
+		jmp_buf jump;
+	};
+
+	static void jpegError(j_common_ptr decompress) {
+		longjmp(reinterpret_cast<JpegError*>(decompress->err)->jump, 1);
+	}
+
+	static void jpegMessage(j_common_ptr) {}
+
+	static void jpegErrorMessage(j_common_ptr decompress, std::string &error) {
+		char message[JMSG_LENGTH_MAX];
+		(*decompress->err->format_message)(decompress, message);
+		error = message;
+	}
+
+	static bool readJpegSize(EncodedImage &image) {
+		jpeg_decompress_struct decompress;
+		JpegError error;
+		decompress.err = jpeg_std_error(&error.manager);
+		error.manager.error_exit = jpegError;
+		error.manager.output_message = jpegMessage;
+		if(setjmp(error.jump)) {
+			jpegErrorMessage((j_common_ptr)&decompress, image.error);
+			jpeg_destroy_decompress(&decompress);
+			return false;
+		}
+		jpeg_create_decompress(&decompress);
+		jpeg_mem_src(&decompress, image.data.data(), (unsigned long)image.data.size());
+		jpeg_read_header(&decompress, TRUE);
+		image.width = (int)decompress.image_width;
+		image.height = (int)decompress.image_height;
+		jpeg_destroy_decompress(&decompress);
+		return true;
+	}
+
+	static bool decodeJpeg(EncodedImage &image, unsigned char* pixels, size_t stride, unsigned flags) {
+		jpeg_decompress_struct decompress;
+		JpegError error;
+		decompress.err = jpeg_std_error(&error.manager);
+		error.manager.error_exit = jpegError;
+		error.manager.output_message = jpegMessage;
+		if(setjmp(error.jump)) {
+			jpegErrorMessage((j_common_ptr)&decompress, image.error);
+			jpeg_destroy_decompress(&decompress);
+			return false;
+		}
+		jpeg_create_decompress(&decompress);
+		jpeg_mem_src(&decompress, image.data.data(), (unsigned long)image.data.size());
+		jpeg_read_header(&decompress, TRUE);
+#ifdef JCS_EXTENSIONS
+		//libjpeg-turbo writes the alpha byte itself
+		decompress.out_color_space = JCS_EXT_RGBA;
+#else
+		decompress.out_color_space = JCS_RGB;
+#endif
+		jpeg_start_decompress(&decompress);
+		if((int)decompress.output_width != image.width || (int)decompress.output_height != image.height) {
+			image.error = "unexpected image size";
+			jpeg_destroy_decompress(&decompress);
+			return false;
+		}
+		while(decompress.output_scanline < decompress.output_height) {
+			unsigned char* row = pixels + decompress.output_scanline * stride;
+			jpeg_read_scanlines(&decompress, &row, 1);
+#ifndef JCS_EXTENSIONS
+			//spread RGB out to RGBA, from the end so nothing is overwritten before it's read
+			for(int x = image.width - 1; x >= 0; x--) {
+				row[x * 4 + 3] = 0xFF;
+				row[x * 4 + 2] = row[x * 3 + 2];
+				row[x * 4 + 1] = row[x * 3 + 1];
+				row[x * 4] = row[x * 3];
+			}
+#endif
+			finishPixels(row, image.width, flags);
+		}
+		jpeg_finish_decompress(&decompress);
+		jpeg_destroy_decompress(&decompress);
+		return true;
+	}
+
+	JobSystem &jobs;
+};
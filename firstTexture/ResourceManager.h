@@ -0,0 +1,301 @@
+/*
+	Owns every OpenGL object the textured cube demo creates.
+
+	Objects are handed out as ResourceHandles: a slot index plus a generation number. When a slot is reused
+	its generation goes up, so a handle to something that has been freed returns 0 instead of whatever
+	now lives in the slot.
+
+	Resources with a key (an asset path, or a hash of the data for buffers) are shared. Asking for the same key
+	again bumps the reference count instead of creating a second copy. When the last reference is released a
+	keyed resource stays cached, so it can be picked up again for free. Cached resources are evicted least
+	recently used first once their type goes over its memory budget.
+
+	The GPU may still be drawing with an object for a couple of frames after we stop using it, so nothing is
+	deleted straight away. Deletes are queued and only done once FRAMES_IN_FLIGHT frames have finished.
+*/
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+enum ResourceType {
+	RESOURCE_BUFFER,
+	RESOURCE_TEXTURE,
+	RESOURCE_SHADER,
+	RESOURCE_PROGRAM,
+	RESOURCE_TYPE_COUNT
+};
+
+struct ResourceHandle {
+	uint32_t index = 0;
+	uint32_t generation = 0; //0 is never a live generation, so a default handle is always invalid
+};
+
+//FNV-1a, used to find buffers that might hold identical data
+inline uint64_t hashBytes(const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for(size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+class ResourceManager {
+public:
+	static const uint64_t FRAMES_IN_FLIGHT = 2;
+
+	ResourceManager() {
+		for(int type = 0; type < RESOURCE_TYPE_COUNT; type++) {
+			budget[type] = 0;
+			usedBytes[type] = 0;
+			liveCount[type] = 0;
+			evictions[type] = 0;
+		}
+	}
+
+	//0 means no budget for that type
+	void setBudget(ResourceType type, size_t bytes) {
+		budget[type] = bytes;
+	}
+
+	//look up a shared resource. Returns an invalid handle if nothing with that key is loaded.
+	ResourceHandle acquire(const std::string &key) {
+		auto found = keyToSlot.find(key);
+		if(found == keyToSlot.end()) {
+			return ResourceHandle();
+		}
+		Slot &slot = slots[found->second];
+		slot.refCount++;
+		slot.lastUsedFrame = frame;
+		return handleFor(found->second);
+	}
+
+	//take ownership of an OpenGL object that has just been created. Pass an empty key for unshared resources.
+	//If something with the same key is already loaded it stays the shared copy: the new object is queued
+	//for deletion and a reference to the existing one is returned instead.
+	ResourceHandle add(ResourceType type, const std::string &key, GLuint name, size_t bytes) {
+		if(!key.empty() && keyToSlot.count(key) != 0) {
+			pendingDeletes.push_back(PendingDelete{type, name, frame});
+			return acquire(key);
+		}
+		uint32_t index;
+		if(!freeSlots.empty()) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		} else {
+			index = (uint32_t)slots.size();
+			slots.push_back(Slot());
+		}
+		Slot &slot = slots[index];
+		slot.type = type;
+		slot.name = name;
+		slot.bytes = bytes;
+		slot.refCount = 1;
+		slot.lastUsedFrame = frame;
+		slot.key = key;
+		if(!key.empty()) {
+			keyToSlot[key] = index;
+		}
+		usedBytes[type] += bytes;
+		liveCount[type]++;
+		return handleFor(index);
+	}
+
+	//the OpenGL name behind a handle, or 0 if the handle is stale
+	GLuint get(ResourceHandle handle) {
+		if(!isValid(handle)) {
+			return 0;
+		}
+		Slot &slot = slots[handle.index];
+		slot.lastUsedFrame = frame;
+		return slot.name;
+	}
+
+	//for resources whose size changes after creation, like streamed textures
+	void setBytes(ResourceHandle handle, size_t bytes) {
+		if(!isValid(handle)) {
+			return;
+		}
+		Slot &slot = slots[handle.index];
+		usedBytes[slot.type] = usedBytes[slot.type] - slot.bytes + bytes;
+		slot.bytes = bytes;
+	}
+
+	//how many bytes a resource was added with, or 0 if the handle is stale
+	size_t sizeOf(ResourceHandle handle) const {
+		return isValid(handle) ? slots[handle.index].bytes : 0;
+	}
+
+	bool isValid(ResourceHandle handle) const {
+		return handle.index < slots.size() && handle.generation != 0 && slots[handle.index].generation == handle.generation;
+	}
+
+	//drop a reference. Keyed resources stay cached until evicted, everything else is queued for deletion.
+	void release(ResourceHandle &handle) {
+		if(!isValid(handle)) {
+			return;
+		}
+		Slot &slot = slots[handle.index];
+		if(slot.refCount > 0 && --slot.refCount == 0 && slot.key.empty()) {
+			destroy(handle.index);
+		}
+		handle = ResourceHandle();
+	}
+
+	//call once per frame after the swap. Deletes objects the GPU is done with and applies the budgets.
+	void endFrame() {
+		frame++;
+		size_t kept = 0;
+		for(size_t i = 0; i < pendingDeletes.size(); i++) {
+			if(frame - pendingDeletes[i].frame >= FRAMES_IN_FLIGHT) {
+				deleteObject(pendingDeletes[i].type, pendingDeletes[i].name);
+			} else {
+				pendingDeletes[kept++] = pendingDeletes[i];
+			}
+		}
+		pendingDeletes.resize(kept);
+
+		for(int type = 0; type < RESOURCE_TYPE_COUNT; type++) {
+			while(budget[type] != 0 && usedBytes[type] > budget[type]) {
+				if(!evictLeastRecentlyUsed((ResourceType)type)) {
+					break;
+				}
+			}
+		}
+	}
+
+	//delete everything right now, whether or not it was released. Only for shutdown.
+	void shutdown() {
+		glFinish();
+		for(const PendingDelete &pending : pendingDeletes) {
+			deleteObject(pending.type, pending.name);
+		}
+		pendingDeletes.clear();
+		for(uint32_t i = 0; i < slots.size(); i++) {
+			if(slots[i].name != 0) {
+				deleteObject(slots[i].type, slots[i].name);
+				slots[i].name = 0;
+			}
+		}
+		slots.clear();
+		freeSlots.clear();
+		keyToSlot.clear();
+		for(int type = 0; type < RESOURCE_TYPE_COUNT; type++) {
+			usedBytes[type] = 0;
+			liveCount[type] = 0;
+		}
+	}
+
+	size_t bytesUsed(ResourceType type) const {
+		return usedBytes[type];
+	}
+
+	void printStats() const {
+		static const char* typeNames[RESOURCE_TYPE_COUNT] = {"buffers", "textures", "shaders", "programs"};
+		std::printf("GPU resources (frame %llu, %zu waiting for deletion):\n", (unsigned long long)frame, pendingDeletes.size());
+		for(int type = 0; type < RESOURCE_TYPE_COUNT; type++) {
+			std::printf("  %-9s %4u live, %10.3f MB", typeNames[type], liveCount[type], usedBytes[type] / (1024.0 * 1024.0));
+			if(budget[type] != 0) {
+				std::printf(" of %.3f MB budget", budget[type] / (1024.0 * 1024.0));
+			}
+			std::printf(", %u evicted\n", evictions[type]);
+		}
+	}
+
+private:
+	struct Slot {
+		ResourceType type = RESOURCE_BUFFER;
+		GLuint name = 0;
+		uint32_t generation = 1;
+		uint32_t refCount = 0;
+		size_t bytes = 0;
+		uint64_t lastUsedFrame = 0;
+		std::string key;
+	};
+
+	struct PendingDelete {
+		ResourceType type;
+		GLuint name;
+		uint64_t frame;
+	};
+
+	ResourceHandle handleFor(uint32_t index) const {
+		ResourceHandle handle;
+		handle.index = index;
+		handle.generation = slots[index].generation;
+		return handle;
+	}
+
+	//free the slot now and queue the OpenGL object to be deleted once in-flight frames are done with it
+	void destroy(uint32_t index) {
+		Slot &slot = slots[index];
+		pendingDeletes.push_back(PendingDelete{slot.type, slot.name, frame});
+		usedBytes[slot.type] -= slot.bytes;
+		liveCount[slot.type]--;
+		if(!slot.key.empty()) {
+			keyToSlot.erase(slot.key);
+			slot.key.clear();
+		}
+		slot.name = 0;
+		slot.bytes = 0;
+		slot.refCount = 0;
+		//skip generation 0 when it wraps, it's reserved for invalid handles
+		if(++slot.generation == 0) {
+			slot.generation = 1;
+		}
+		freeSlots.push_back(index);
+	}
+
+	//evict the unreferenced cached resource of this type that was used longest ago
+	bool evictLeastRecentlyUsed(ResourceType type) {
+		uint32_t oldest = UINT32_MAX;
+		for(uint32_t i = 0; i < slots.size(); i++) {
+			const Slot &slot = slots[i];
+			if(slot.name != 0 && slot.type == type && slot.refCount == 0 &&
+				(oldest == UINT32_MAX || slot.lastUsedFrame < slots[oldest].lastUsedFrame)) {
+				oldest = i;
+			}
+		}
+		if(oldest == UINT32_MAX) {
+			return false;
+		}
+		evictions[type]++;
+		destroy(oldest);
+		return true;
+	}
+
+	static void deleteObject(ResourceType type, GLuint name) {
+		switch(type) {
+			case RESOURCE_BUFFER:
+			glDeleteBuffers(1, &name);
+			break;
+			case RESOURCE_TEXTURE:
+			glDeleteTextures(1, &name);
+			break;
+			case RESOURCE_SHADER:
+			glDeleteShader(name);
+			break;
+			case RESOURCE_PROGRAM:
+			glDeleteProgram(name);
+			break;
+			default:
+			break;
+		}
+	}
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<std::string, uint32_t> keyToSlot;
+	std::vector<PendingDelete> pendingDeletes;
+	uint64_t frame = 0;
+	size_t budget[RESOURCE_TYPE_COUNT];
+	size_t usedBytes[RESOURCE_TYPE_COUNT];
+	uint32_t liveCount[RESOURCE_TYPE_COUNT];
+	uint32_t evictions[RESOURCE_TYPE_COUNT];
+};
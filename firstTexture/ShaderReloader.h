@@ -0,0 +1,434 @@
+/*
+	Reloads the textured cube's shaders while the demo is running.
+
+	The shader files are watched with inotify (on other systems their modification times are checked a couple
+	of times a second). Once a file has been quiet for a moment, so an editor's save has finished, the new
+	sources are compiled and linked into a brand new program. The render thread never asks for a compile or link
+	status before the driver is done, since that makes it finish the work there and then. With
+	GL_KHR_parallel_shader_compile the driver compiles on its own threads and update() polls
+	GL_COMPLETION_STATUS_KHR once a frame until it is done. Without the extension the build is handed to a thread
+	of our own with a second GL context that shares objects with the render context. That thread is the one that
+	waits for the link, and update() only picks the program up once it says it's finished.
+
+	Only a program that linked and passes the demo's own check (that the attributes and uniforms it needs are
+	there) is swapped in. The old program is released through the resource manager, so it isn't deleted while a
+	frame in flight could still be using it. If anything fails, the error is printed and the old program stays.
+*/
+
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ResourceManager.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#else
+#include <filesystem>
+#endif
+
+class ShaderReloader {
+public:
+	//checks a freshly linked program and picks up its attribute and uniform locations. Return false to reject it.
+	typedef bool (*ProgramCheck)(GLuint programID);
+
+	ShaderReloader(ResourceManager &resources) : resources(resources) {}
+
+	//start watching the two files that make up the program. Call with the render context current.
+	//Returns false if they can't be watched, or there is no way to build without stalling the render thread.
+	bool watch(const std::string &vertexFile, const std::string &fragFile, ProgramCheck check) {
+		files[0] = vertexFile;
+		files[1] = fragFile;
+		this->check = check;
+		if(GLEW_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		} else if(!startCompileThread()) {
+			std::cerr << "No GL_KHR_parallel_shader_compile and no shared context to compile on, shader reloading is off\n";
+			return false;
+		}
+#ifdef __linux__
+		notifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(notifyFD == -1) {
+			perror("inotify_init1");
+			return false;
+		}
+		//watch the folders rather than the files, editors often save by writing a new file and renaming it over the old one
+		for(const std::string &file : files) {
+			std::string folder = directoryOf(file);
+			if(inotify_add_watch(notifyFD, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+				perror(folder.c_str());
+				stop();
+				return false;
+			}
+		}
+#else
+		for(int i = 0; i < 2; i++) {
+			std::error_code error;
+			writeTimes[i] = std::filesystem::last_write_time(files[i], error);
+		}
+#endif
+		return true;
+	}
+
+	//stop watching and throw away a build that hasn't finished. Needs the GL context to still be current.
+	void stop() {
+#ifdef __linux__
+		if(notifyFD != -1) {
+			close(notifyFD);
+			notifyFD = -1;
+		}
+#endif
+		stopCompileThread();
+		discardPending();
+	}
+
+	//call once per frame before drawing. Returns true when program has been replaced by a newly built one.
+	bool update(ResourceHandle &program) {
+		auto start = Clock::now();
+		bool swapped = false;
+		if(filesChanged()) {
+			changed = true;
+			lastChange = start;
+		}
+		if(building) {
+			swapped = finishBuild(program);
+		} else if(changed && start - lastChange > std::chrono::milliseconds(100)) {
+			changed = false;
+			startBuild();
+		}
+		mainThreadTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return swapped;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	static std::string directoryOf(const std::string &file) {
+		size_t slash = file.find_last_of('/');
+		return slash == std::string::npos ? "." : file.substr(0, slash);
+	}
+
+	static std::string nameOf(const std::string &file) {
+		size_t slash = file.find_last_of('/');
+		return slash == std::string::npos ? file : file.substr(slash + 1);
+	}
+
+	//drain the change notifications and say whether any were for our files
+	bool filesChanged() {
+		bool ours = false;
+#ifdef __linux__
+		if(notifyFD == -1) {
+			return false;
+		}
+		alignas(inotify_event) char buffer[sizeof(inotify_event) + NAME_MAX + 1];
+		while(true) {
+			ssize_t length = read(notifyFD, buffer, sizeof(buffer));
+			if(length <= 0) {
+				break;
+			}
+			for(char* position = buffer; position < buffer + length; ) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+				if(event->len > 0 && (nameOf(files[0]) == event->name || nameOf(files[1]) == event->name)) {
+					ours = true;
+				}
+				position += sizeof(inotify_event) + event->len;
+			}
+		}
+#else
+		//stat the files a couple of times a second
+		if(++framesSinceCheck < 30) {
+			return false;
+		}
+		framesSinceCheck = 0;
+		for(int i = 0; i < 2; i++) {
+			std::error_code error;
+			auto writeTime = std::filesystem::last_write_time(files[i], error);
+			if(!error && writeTime != writeTimes[i]) {
+				writeTimes[i] = writeTime;
+				ours = true;
+			}
+		}
+#endif
+		return ours;
+	}
+
+	static bool readFile(const std::string &fileName, std::string &contents) {
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if(file.fail()) {
+			perror(fileName.c_str());
+			return false;
+		}
+		contents.assign(file.tellg(), '\0');
+		file.seekg(0);
+		file.read(&contents[0], contents.size());
+		return !file.fail();
+	}
+
+	//issue the compiles and the link without waiting for any of them
+	void startBuild() {
+		std::string sources[2];
+		if(!readFile(files[0], sources[0]) || !readFile(files[1], sources[1])) {
+			std::cerr << "Shader reload skipped, keeping the old program\n";
+			return;
+		}
+		buildStart = Clock::now();
+		mainThreadTime = 0.0;
+		building = true;
+		if(workerContext != nullptr) {
+			{
+				std::lock_guard<std::mutex> lock(workerMutex);
+				workerSources[0].swap(sources[0]);
+				workerSources[1].swap(sources[1]);
+				workerHasJob = true;
+			}
+			workerWake.notify_one();
+			return;
+		}
+		pendingProgram = issueBuild(sources, pendingShaders);
+	}
+
+	//swap the program in if it's finished and good. Returns true if it was swapped.
+	bool finishBuild(ResourceHandle &program) {
+		std::string log;
+		if(workerContext != nullptr) {
+			if(!workerFinished.load(std::memory_order_acquire)) {
+				return false; //try again next frame
+			}
+			std::lock_guard<std::mutex> lock(workerMutex);
+			workerFinished.store(false, std::memory_order_relaxed);
+			pendingProgram = workerProgram;
+			workerProgram = 0;
+			log.swap(workerLog);
+		} else {
+			GLint done = GL_FALSE;
+			glGetProgramiv(pendingProgram, GL_COMPLETION_STATUS_KHR, &done);
+			if(!done) {
+				return false; //try again next frame
+			}
+			//the link is done, so asking for its status doesn't wait
+			GLint linked = GL_FALSE;
+			glGetProgramiv(pendingProgram, GL_LINK_STATUS, &linked);
+			if(!linked) {
+				log = buildLog(pendingProgram, pendingShaders);
+			}
+			//the program keeps what it needs, the shader objects can go once it's linked
+			deleteShaders(pendingProgram, pendingShaders);
+			if(!linked) {
+				glDeleteProgram(pendingProgram);
+				pendingProgram = 0;
+			}
+		}
+		building = false;
+
+		if(pendingProgram == 0) {
+			std::cerr << log << "Shader reload failed, keeping the old program\n";
+			return false;
+		}
+		if(!check(pendingProgram)) {
+			std::cerr << "Reloaded shaders are missing inputs the demo needs, keeping the old program\n";
+			discardPending();
+			return false;
+		}
+
+		resources.release(program);
+		program = resources.add(RESOURCE_PROGRAM, "", pendingProgram, 0);
+		pendingProgram = 0;
+		double total = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+		std::printf("Reloaded %s and %s in %.2f ms, %.3f ms of it on the render thread\n",
+			files[0].c_str(), files[1].c_str(), total, mainThreadTime);
+		return true;
+	}
+
+	void discardPending() {
+		deleteShaders(0, pendingShaders);
+		if(pendingProgram != 0) {
+			glDeleteProgram(pendingProgram);
+			pendingProgram = 0;
+		}
+		building = false;
+	}
+
+	//create the shaders and the program and issue the compiles and the link. Nothing here waits for the driver.
+	static GLuint issueBuild(const std::string sources[2], GLuint shaders[2]) {
+		const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+		for(int i = 0; i < 2; i++) {
+			const char* contentsPtr = sources[i].c_str();
+			shaders[i] = glCreateShader(types[i]);
+			glShaderSource(shaders[i], 1, &contentsPtr, NULL);
+			glCompileShader(shaders[i]);
+		}
+		GLuint program = glCreateProgram();
+		glAttachShader(program, shaders[0]);
+		glAttachShader(program, shaders[1]);
+		glLinkProgram(program);
+		return program;
+	}
+
+	static void deleteShaders(GLuint program, GLuint shaders[2]) {
+		for(int i = 0; i < 2; i++) {
+			if(shaders[i] != 0) {
+				if(program != 0) {
+					glDetachShader(program, shaders[i]);
+				}
+				glDeleteShader(shaders[i]);
+				shaders[i] = 0;
+			}
+		}
+	}
+
+	//the compile errors of whichever shaders failed, then the link log
+	std::string buildLog(GLuint program, const GLuint shaders[2]) const {
+		std::string log;
+		for(int i = 0; i < 2; i++) {
+			GLint compiled = GL_FALSE;
+			glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+			if(compiled) {
+				continue;
+			}
+			log += "ERROR: " + files[i] + " FAILED TO COMPILE\n";
+			GLint maxLength = 0;
+			glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &maxLength);
+			std::vector<char> errorLog(maxLength + 1);
+			glGetShaderInfoLog(shaders[i], maxLength, &maxLength, &errorLog[0]);
+			log += &errorLog[0];
+			log += "\n";
+		}
+		GLint maxLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+		std::vector<char> errorLog(maxLength + 1);
+		glGetProgramInfoLog(program, maxLength, &maxLength, &errorLog[0]);
+		log += &errorLog[0];
+		log += "\n";
+		return log;
+	}
+
+	//===============
+	//COMPILE THREAD
+	//===============
+
+	//make a context that shares objects with the current one and start a thread to build on it
+	bool startCompileThread() {
+		window = SDL_GL_GetCurrentWindow();
+		SDL_GLContext renderContext = SDL_GL_GetCurrentContext();
+		if(window == nullptr || renderContext == nullptr) {
+			return false;
+		}
+		SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+		workerContext = SDL_GL_CreateContext(window);
+		SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+		//creating a context makes it current, so give the render thread its own back
+		SDL_GL_MakeCurrent(window, renderContext);
+		if(workerContext == nullptr) {
+			std::cerr << "Couldn't create a context for compiling shaders: " << SDL_GetError() << "\n";
+			return false;
+		}
+		workerQuit = false;
+		worker = std::thread(&ShaderReloader::compileThread, this);
+		return true;
+	}
+
+	//waits for the build it's in the middle of, if any
+	void stopCompileThread() {
+		if(worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(workerMutex);
+				workerQuit = true;
+			}
+			workerWake.notify_one();
+			worker.join();
+		}
+		if(workerProgram != 0) {
+			glDeleteProgram(workerProgram);
+			workerProgram = 0;
+		}
+		workerFinished = false;
+		if(workerContext != nullptr) {
+			SDL_GL_DeleteContext(workerContext);
+			workerContext = nullptr;
+		}
+	}
+
+	void compileThread() {
+		if(SDL_GL_MakeCurrent(window, workerContext) != 0) {
+			std::cerr << "Couldn't use the shader compile context: " << SDL_GetError() << "\n";
+			return;
+		}
+		std::unique_lock<std::mutex> lock(workerMutex);
+		while(true) {
+			workerWake.wait(lock, [this] { return workerQuit || workerHasJob; });
+			if(workerQuit) {
+				break;
+			}
+			workerHasJob = false;
+			std::string sources[2];
+			sources[0].swap(workerSources[0]);
+			sources[1].swap(workerSources[1]);
+			lock.unlock();
+
+			//this thread has nothing else to do, so it's fine for it to wait on the link here
+			GLuint shaders[2];
+			GLuint program = issueBuild(sources, shaders);
+			GLint linked = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &linked);
+			std::string log;
+			if(!linked) {
+				log = buildLog(program, shaders);
+			}
+			deleteShaders(program, shaders);
+			if(!linked) {
+				glDeleteProgram(program);
+				program = 0;
+			}
+			//make sure the program is complete before the render context starts using it
+			glFinish();
+
+			lock.lock();
+			workerProgram = program;
+			workerLog.swap(log);
+			workerFinished.store(true, std::memory_order_release);
+		}
+		lock.unlock();
+		SDL_GL_MakeCurrent(window, nullptr);
+	}
+
+	ResourceManager &resources;
+	std::string files[2];
+	ProgramCheck check = nullptr;
+#ifdef __linux__
+	int notifyFD = -1;
+#else
+	std::filesystem::file_time_type writeTimes[2];
+	int framesSinceCheck = 0;
+#endif
+	bool changed = false;
+	Clock::time_point lastChange, buildStart;
+	GLuint pendingShaders[2] = {0, 0};
+	GLuint pendingProgram = 0;
+	bool building = false;
+	double mainThreadTime = 0.0; //time update() has spent on the current build
+
+	//only used without GL_KHR_parallel_shader_compile
+	SDL_Window* window = nullptr;
+	SDL_GLContext workerContext = nullptr;
+	std::thread worker;
+	std::mutex workerMutex;
+	std::condition_variable workerWake;
+	bool workerQuit = false;
+	bool workerHasJob = false;
+	std::string workerSources[2];
+	std::atomic<bool> workerFinished{false};
+	GLuint workerProgram = 0; //0 if the build failed
+	std::string workerLog;
+};
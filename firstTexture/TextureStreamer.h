@@ -0,0 +1,291 @@
+/*
+	Streams mip levels of textures in and out of video memory depending on how big they are on screen.
+
+	Every texture starts with only its small mips uploaded. Each frame the demo reports the finest mip level
+	each texture needs (from how many pixels the object covers), and update() uploads finer levels a few rows
+	at a time, never more than uploadBudget bytes per frame, so a big level doesn't cause a hitch.
+	GL_TEXTURE_BASE_LEVEL is only moved once a level is completely uploaded, so the sampler never sees a
+	half-finished mip. Levels that haven't been needed for evictDelay frames are freed again.
+
+	The full mip chain is kept in system memory and only the resident part lives on the GPU.
+*/
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ResourceManager.h"
+
+class TextureStreamer {
+public:
+	TextureStreamer(ResourceManager &resources) : resources(resources) {}
+
+	//most bytes uploaded per update()
+	void setUploadBudget(size_t bytesPerFrame) {
+		uploadBudget = bytesPerFrame;
+	}
+
+	//frames a level has to go unused before it's dropped, so objects near a mip boundary don't thrash
+	void setEvictDelay(int frames) {
+		evictDelay = frames;
+	}
+
+	//start streaming an RGBA8 image, keeping only mips no bigger than initialSize resident to begin with.
+	//the texture is registered with the resource manager under key. Returns the streamer's index for it.
+	int add(const std::string &key, int width, int height, const unsigned char* pixels, int initialSize = 32) {
+		StreamedTexture texture;
+		buildMipChain(texture, width, height, pixels);
+
+		glGenTextures(1, &texture.textureID);
+		glBindTexture(GL_TEXTURE_2D, texture.textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.mips.size() - 1);
+
+		//the coarse levels go up straight away, whatever the budget
+		int level = (int)texture.mips.size() - 1;
+		while(level > 0 && texture.mips[level - 1].width <= initialSize && texture.mips[level - 1].height <= initialSize) {
+			level--;
+		}
+		for(int i = (int)texture.mips.size() - 1; i >= level; i--) {
+			const MipLevel &mip = texture.mips[i];
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+			texture.allocatedBytes += mip.pixels.size();
+		}
+		texture.residentLevel = level;
+		texture.wantedLevel = level;
+		texture.requestedLevel = (float)level;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+		texture.handle = resources.add(RESOURCE_TEXTURE, key, texture.textureID, texture.allocatedBytes);
+		textures.push_back(std::move(texture));
+		return (int)textures.size() - 1;
+	}
+
+	ResourceHandle handle(int index) const {
+		return textures[index].handle;
+	}
+
+	int mipCount(int index) const {
+		return (int)textures[index].mips.size();
+	}
+
+	//size of the full resolution level, which is what lodForCoverage needs
+	int width(int index) const {
+		return textures[index].mips[0].width;
+	}
+
+	int height(int index) const {
+		return textures[index].mips[0].height;
+	}
+
+	//the streamer's index for a texture it registered with the resource manager, or -1
+	int indexOf(ResourceHandle handle) const {
+		for(size_t i = 0; i < textures.size(); i++) {
+			if(textures[i].handle.index == handle.index && textures[i].handle.generation == handle.generation) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	//feedback for this frame: something needs this texture at mip level lod. The finest request wins.
+	void request(int index, float lod) {
+		StreamedTexture &texture = textures[index];
+		if(lod < texture.requestedLevel) {
+			texture.requestedLevel = lod;
+		}
+	}
+
+	//mip level to use for an object that covers projectedPixels pixels across with a texture size texels across
+	static float lodForCoverage(float textureSize, float projectedPixels) {
+		if(projectedPixels <= 0.0f) {
+			return 1000.0f;
+		}
+		return std::log2(textureSize / projectedPixels);
+	}
+
+	//once per frame: act on the feedback, upload within the budget and drop unused levels
+	void update() {
+		uploadedLastFrame = 0;
+		for(StreamedTexture &texture : textures) {
+			int coarsest = (int)texture.mips.size() - 1;
+			float requested = texture.requestedLevel < 0.0f ? 0.0f : texture.requestedLevel;
+			texture.wantedLevel = (int)std::floor(requested) < coarsest ? (int)std::floor(requested) : coarsest;
+			texture.requestedLevel = (float)coarsest;
+			evictUnused(texture);
+		}
+
+		size_t budgetLeft = uploadBudget;
+		while(budgetLeft > 0) {
+			//the texture that's furthest from what it needs goes first
+			StreamedTexture* neediest = nullptr;
+			for(StreamedTexture &texture : textures) {
+				if(texture.wantedLevel < texture.residentLevel &&
+					(neediest == nullptr || texture.residentLevel - texture.wantedLevel > neediest->residentLevel - neediest->wantedLevel)) {
+					neediest = &texture;
+				}
+			}
+			if(neediest == nullptr) {
+				break;
+			}
+			size_t uploaded = uploadRows(*neediest, budgetLeft);
+			budgetLeft = uploaded < budgetLeft ? budgetLeft - uploaded : 0;
+			uploadedLastFrame += uploaded;
+		}
+		totalUploaded += uploadedLastFrame;
+		frames++;
+	}
+
+	size_t residentBytes() const {
+		size_t bytes = 0;
+		for(const StreamedTexture &texture : textures) {
+			bytes += texture.allocatedBytes;
+		}
+		return bytes;
+	}
+
+	size_t uploadedBytesLastFrame() const {
+		return uploadedLastFrame;
+	}
+
+	void printStats() const {
+		std::printf("texture streaming: %.3f MB resident, %.3f MB uploaded last frame, %.3f MB per frame on average\n",
+			residentBytes() / (1024.0 * 1024.0), uploadedLastFrame / (1024.0 * 1024.0),
+			frames ? totalUploaded / (1024.0 * 1024.0) / frames : 0.0);
+		for(size_t i = 0; i < textures.size(); i++) {
+			const StreamedTexture &texture = textures[i];
+			std::printf("  texture %zu: resident mip %d (%dx%d), wanted mip %d\n", i, texture.residentLevel,
+				texture.mips[texture.residentLevel].width, texture.mips[texture.residentLevel].height, texture.wantedLevel);
+		}
+	}
+
+private:
+	struct MipLevel {
+		int width, height;
+		std::vector<unsigned char> pixels;
+	};
+
+	struct StreamedTexture {
+		GLuint textureID = 0;
+		ResourceHandle handle;
+		std::vector<MipLevel> mips;
+		int residentLevel = 0;     //finest level that is completely uploaded, and the texture's base level
+		int wantedLevel = 0;       //finest level the last frame's feedback asked for
+		float requestedLevel = 0;  //feedback gathered during the current frame
+		int uploadingLevel = -1;   //level currently being uploaded, -1 if none
+		int uploadedRows = 0;
+		int framesUnused = 0;
+		size_t allocatedBytes = 0;
+	};
+
+	//2x2 box filter down to 1x1
+	static void buildMipChain(StreamedTexture &texture, int width, int height, const unsigned char* pixels) {
+		MipLevel base;
+		base.width = width;
+		base.height = height;
+		base.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+		texture.mips.push_back(std::move(base));
+
+		while(texture.mips.back().width > 1 || texture.mips.back().height > 1) {
+			const MipLevel &source = texture.mips.back();
+			MipLevel mip;
+			mip.width = source.width > 1 ? source.width / 2 : 1;
+			mip.height = source.height > 1 ? source.height / 2 : 1;
+			mip.pixels.resize((size_t)mip.width * mip.height * 4);
+			for(int y = 0; y < mip.height; y++) {
+				int y0 = y * 2 < source.height ? y * 2 : source.height - 1;
+				int y1 = y * 2 + 1 < source.height ? y * 2 + 1 : y0;
+				for(int x = 0; x < mip.width; x++) {
+					int x0 = x * 2 < source.width ? x * 2 : source.width - 1;
+					int x1 = x * 2 + 1 < source.width ? x * 2 + 1 : x0;
+					for(int c = 0; c < 4; c++) {
+						int sum = source.pixels[((size_t)y0 * source.width + x0) * 4 + c] +
+							source.pixels[((size_t)y0 * source.width + x1) * 4 + c] +
+							source.pixels[((size_t)y1 * source.width + x0) * 4 + c] +
+							source.pixels[((size_t)y1 * source.width + x1) * 4 + c];
+						mip.pixels[((size_t)y * mip.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+			texture.mips.push_back(std::move(mip));
+		}
+	}
+
+	//upload as many rows of the next finer level as the budget allows, at least one so we always make progress
+	size_t uploadRows(StreamedTexture &texture, size_t budget) {
+		int level = texture.residentLevel - 1;
+		const MipLevel &mip = texture.mips[level];
+		size_t rowBytes = (size_t)mip.width * 4;
+
+		glBindTexture(GL_TEXTURE_2D, texture.textureID);
+		if(texture.uploadingLevel != level) {
+			//allocate the level without data, the rows are filled in over the next frames
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			texture.uploadingLevel = level;
+			texture.uploadedRows = 0;
+			texture.allocatedBytes += mip.pixels.size();
+			resources.setBytes(texture.handle, texture.allocatedBytes);
+		}
+
+		int rows = (int)(budget / rowBytes);
+		if(rows < 1) {
+			rows = 1;
+		}
+		if(rows > mip.height - texture.uploadedRows) {
+			rows = mip.height - texture.uploadedRows;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, texture.uploadedRows, mip.width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+			mip.pixels.data() + texture.uploadedRows * rowBytes);
+		texture.uploadedRows += rows;
+
+		if(texture.uploadedRows == mip.height) {
+			texture.residentLevel = level;
+			texture.uploadingLevel = -1;
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+		}
+		return rows * rowBytes;
+	}
+
+	//free the finest resident level (or a half-uploaded one) once it hasn't been wanted for evictDelay frames
+	void evictUnused(StreamedTexture &texture) {
+		if(texture.uploadingLevel != -1 && texture.wantedLevel >= texture.residentLevel) {
+			freeLevel(texture, texture.uploadingLevel);
+			texture.uploadingLevel = -1;
+		}
+
+		int coarsest = (int)texture.mips.size() - 1;
+		if(texture.wantedLevel <= texture.residentLevel || texture.residentLevel == coarsest) {
+			texture.framesUnused = 0;
+			return;
+		}
+		if(++texture.framesUnused < evictDelay) {
+			return;
+		}
+		texture.framesUnused = 0;
+
+		//move the base level first so the sampler never points at a freed level
+		glBindTexture(GL_TEXTURE_2D, texture.textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentLevel + 1);
+		freeLevel(texture, texture.residentLevel);
+		texture.residentLevel++;
+	}
+
+	void freeLevel(StreamedTexture &texture, int level) {
+		glBindTexture(GL_TEXTURE_2D, texture.textureID);
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		texture.allocatedBytes -= texture.mips[level].pixels.size();
+		resources.setBytes(texture.handle, texture.allocatedBytes);
+	}
+
+	ResourceManager &resources;
+	std::vector<StreamedTexture> textures;
+	size_t uploadBudget = 256 * 1024;
+	int evictDelay = 120;
+	size_t uploadedLastFrame = 0;
+	size_t totalUploaded = 0;
+	uint64_t frames = 0;
+};
@@ -17,34 +17,49 @@
 #include <fstream>
 #include <string.h>
 #include <vector>
+#include <cmath>
+#include <chrono>
+#include "ResourceManager.h"
+#include "TextureStreamer.h"
+#include "ShaderReloader.h"
+#include "ImageDecoder.h"
 
 //================
 //GLOBAL VARIABLES
 //================
-GLuint programID, textureID;
+//every OpenGL object is owned by the resource manager, the demo only keeps handles to them
+ResourceManager resources;
+TextureStreamer streamer(resources);
+//rebuilds the program whenever TexturedCubeShader.vert or .frag is saved
+ShaderReloader shaderReloader(resources);
+//decodes images on the job system's threads instead of with IMG_Load
+JobSystem jobs;
+ImageDecoder decoder(jobs);
+ResourceHandle program, texture;
+int crateTexture; //the crate's index in the texture streamer
 GLint attribute_coord3d, attribute_texcoord, uniform_mvp, uniform_myTexture;
-GLuint vbo_verticies, vbo_color, vbo_texcoords;
-GLuint ibo_elements;
+ResourceHandle vbo_verticies, vbo_color, vbo_texcoords;
+ResourceHandle ibo_elements;
 GLint compileOK, linkOK = GL_FALSE;
 
 int screenWidth = 600;
 int screenHeight = 600;
 
-//load a shader from a file into a string so that openGL can use it.
-void loadShader(const std::string &shaderFile, GLuint id) {
-	std::string line;
-	std::string fileContents = "";
+//how far the cube is from the camera, changed with the up and down arrows to see mips stream in and out
+float cubeDistance = 4.0f;
+const float fieldOfView = 45.0f;
 
-	std::ifstream file;
-	file.open(shaderFile);
+//load a shader from a file into a string so that openGL can use it. Returns false if it couldn't be compiled.
+bool loadShader(const std::string &shaderFile, GLuint id) {
+	std::ifstream file(shaderFile, std::ios::binary | std::ios::ate);
 	if(file.fail()) {
 		perror(shaderFile.c_str());
-		exit(1);
-	}
-	//load the shader file
-	while(std::getline(file, line)) {
-		fileContents += line + '\n';
+		return false;
 	}
+	//read the whole file in one go instead of appending it line by line
+	std::string fileContents(file.tellg(), '\0');
+	file.seekg(0);
+	file.read(&fileContents[0], fileContents.size());
 	file.close();
 
 	//compile shader
@@ -60,11 +75,158 @@ void loadShader(const std::string &shaderFile, GLuint id) {
 		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &maxLength);
 		std::vector<char> errorLog(maxLength);
 		glGetShaderInfoLog(id, maxLength, &maxLength, &errorLog[0]);
-		glDeleteShader(id);
 		std::printf("%s\n", &errorLog[0]);
-		exit(1);
+		return false;
 	}
 	std::cout << "Shader " << shaderFile << " Loaded successfully.\n";
+	return true;
+}
+
+//look up the attributes and uniforms render() needs. The globals are only changed if all of them are there,
+//so a reloaded program that is missing one can be turned down without breaking the one in use.
+bool findLocations(GLuint programID) {
+	const char* attributeName = "coord3d";
+	GLint coord3d = glGetAttribLocation(programID, attributeName);
+	if(coord3d == -1) {
+		std::cerr << "Could not bind attribute: " << attributeName << std::endl;
+		return false;
+	}
+
+	attributeName = "texcoord";
+	GLint texcoord = glGetAttribLocation(programID, attributeName);
+	if(texcoord == -1) {
+		std::cerr << "Could not bind attribute: " << attributeName << std::endl;
+		return false;
+	}
+
+	const char* uniformName = "mvp";
+	GLint mvp = glGetUniformLocation(programID, uniformName);
+	if(mvp == -1) {
+		std::cerr << "Could not bind uniform: " << uniformName << std::endl;
+		return false;
+	}
+
+	attribute_coord3d = coord3d;
+	attribute_texcoord = texcoord;
+	uniform_mvp = mvp;
+	return true;
+}
+
+//create a buffer, or share an existing one that holds exactly the same data. The hash only finds a candidate:
+//it's read back and compared, and different data that happens to have the same hash moves on to the next key.
+ResourceHandle createBuffer(GLenum target, const void* data, size_t size) {
+	uint64_t hash = hashBytes(data, size);
+	std::vector<unsigned char> existing;
+	for(int probe = 0; ; probe++) {
+		char key[48];
+		snprintf(key, sizeof(key), "buffer:%016llx:%d", (unsigned long long)hash, probe);
+		ResourceHandle handle = resources.acquire(key);
+		if(!resources.isValid(handle)) {
+			GLuint bufferID;
+			glGenBuffers(1, &bufferID);
+			glBindBuffer(target, bufferID);
+			glBufferData(target, size, data, GL_STATIC_DRAW);
+			return resources.add(RESOURCE_BUFFER, key, bufferID, size);
+		}
+		if(resources.sizeOf(handle) == size) {
+			existing.resize(size);
+			glBindBuffer(target, resources.get(handle));
+			glGetBufferSubData(target, 0, size, existing.data());
+			if(memcmp(existing.data(), data, size) == 0) {
+				return handle;
+			}
+		}
+		resources.release(handle);
+	}
+}
+
+//load an image file and start streaming it. Returns its index in the streamer, or -1 if it couldn't be loaded.
+int loadTexture(const std::string &imageFile) {
+	//already loaded: share it instead of decoding and uploading a second copy
+	ResourceHandle existing = resources.acquire(imageFile);
+	if(resources.isValid(existing)) {
+		int index = streamer.indexOf(existing);
+		resources.release(existing);
+		if(index != -1) {
+			return index;
+		}
+	}
+
+	//the decoder always produces tightly packed RGBA, which is what the streamer builds its mips from
+	DecodedImage image;
+	if(!ImageDecoder::decodeFile(imageFile, image)) {
+		std::cerr << imageFile << ": " << image.error << std::endl;
+		return -1;
+	}
+	return streamer.add(imageFile, image.width, image.height, image.pixels.data());
+}
+
+//decode every file copies times each way and print how many MB of pixels per second each way produces
+void decodeBenchmark(const std::vector<std::string> &imageFiles, int copies) {
+	std::vector<std::string> files;
+	for(int i = 0; i < copies; i++) {
+		files.insert(files.end(), imageFiles.begin(), imageFiles.end());
+	}
+	typedef std::chrono::steady_clock Clock;
+	auto report = [](const char* name, Clock::time_point start, size_t bytes) {
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::printf("  %-44s %8.2f ms %8.1f MB/s\n", name, seconds * 1000.0, bytes / (1024.0 * 1024.0) / seconds);
+	};
+	//every way produces the same pixels, so they all get measured against the same byte count
+	std::vector<DecodedImage> images;
+	if(!decoder.decodeAll(imageFiles, images)) {
+		return;
+	}
+	size_t bytes = 0;
+	for(const DecodedImage &image : images) {
+		bytes += image.pixels.size() * copies;
+	}
+	std::printf("decoding %zu images, %.1f MB of pixels, on %d threads:\n", files.size(), bytes / (1024.0 * 1024.0), jobs.threadCount());
+
+	//what loadTexture used to do: IMG_Load, convert to RGBA, copy out row by row
+	auto start = Clock::now();
+	bool loaded = true;
+	for(size_t i = 0; i < files.size() && loaded; i++) {
+		SDL_Surface* surface = IMG_Load(files[i].c_str());
+		SDL_Surface* converted = surface ? SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0) : nullptr;
+		SDL_FreeSurface(surface);
+		if(converted == nullptr) {
+			std::cerr << files[i] << ": " << SDL_GetError() << std::endl;
+			loaded = false;
+			break;
+		}
+		std::vector<unsigned char> pixels((size_t)converted->w * converted->h * 4);
+		for(int y = 0; y < converted->h; y++) {
+			memcpy(&pixels[(size_t)y * converted->w * 4], (unsigned char*)converted->pixels + y * converted->pitch, converted->w * 4);
+		}
+		SDL_FreeSurface(converted);
+	}
+	if(loaded) {
+		report("IMG_Load + SDL_ConvertSurfaceFormat", start, bytes);
+	}
+
+	start = Clock::now();
+	for(const std::string &file : files) {
+		DecodedImage image;
+		ImageDecoder::decodeFile(file, image);
+	}
+	report("ImageDecoder, one at a time", start, bytes);
+
+	start = Clock::now();
+	decoder.decodeAll(files, images);
+	report("ImageDecoder::decodeAll", start, bytes);
+
+	start = Clock::now();
+	decoder.decodeAll(files, images, DECODE_BGRA | DECODE_PREMULTIPLY);
+	report("ImageDecoder::decodeAll, BGRA + premultiplied", start, bytes);
+
+	//the textures have to be finished before the clock stops, or this only times handing them to the driver
+	std::vector<GLuint> textures;
+	start = Clock::now();
+	decoder.uploadAll(files, textures);
+	glFinish();
+	report("ImageDecoder::uploadAll, into textures", start, bytes);
+	glDeleteTextures((GLsizei)textures.size(), textures.data());
 }
 
 bool initResources() {
@@ -73,29 +235,11 @@ bool initResources() {
 // TEXTURES
 //==========
 
-SDL_Surface* res_texture = IMG_Load("woodenCrate.png");
-if(res_texture == nullptr) {
-	std::cerr << "IMG_Load: " << IMG_GetError() << std::endl;
+crateTexture = loadTexture("woodenCrate.png");
+if(crateTexture == -1) {
 	return false;
 }
-
-glGenTextures(1, &textureID);
-glBindTexture(GL_TEXTURE_2D, textureID);
-glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-glTexImage2D(
-	GL_TEXTURE_2D, //target
-	0, //level 0 = base, no minmap
-	GL_RGBA, //internalformat
-	res_texture->w, //width
-	res_texture->h, //height
-	0, //border, always 0 in GLES (OpenGL Embedded Systems)
-	GL_RGBA, //format
-	GL_UNSIGNED_BYTE, //type
-	res_texture->pixels
-	);
-
-	SDL_FreeSurface(res_texture);
+texture = resources.acquire("woodenCrate.png");
 
 
 	GLfloat cube_texcoords[2*4*6] = {
@@ -109,9 +253,7 @@ glTexImage2D(
 		memcpy(&cube_texcoords[i*4*2], &cube_texcoords[0], 2*4*sizeof(GLfloat));
 	}
 
-	glGenBuffers(1, &vbo_texcoords);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_texcoords);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_texcoords), cube_texcoords, GL_STATIC_DRAW);
+	vbo_texcoords = createBuffer(GL_ARRAY_BUFFER, cube_texcoords, sizeof(cube_texcoords));
 
 	//VERTICIES
 	GLfloat verticies[] = {
@@ -147,9 +289,7 @@ glTexImage2D(
 		1.0,   1.0,  1.0,
 	};
 
-	glGenBuffers(1, &vbo_verticies);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verticies), verticies, GL_STATIC_DRAW);
+	vbo_verticies = createBuffer(GL_ARRAY_BUFFER, verticies, sizeof(verticies));
 
 
 	//COLORS
@@ -205,13 +345,8 @@ glTexImage2D(
 		22, 23, 20
 	};
 
-	glGenBuffers(1, &ibo_elements);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_elements), cube_elements, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &vbo_color);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_color);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(color), color, GL_STATIC_DRAW);
+	ibo_elements = createBuffer(GL_ELEMENT_ARRAY_BUFFER, cube_elements, sizeof(cube_elements));
+	vbo_color = createBuffer(GL_ARRAY_BUFFER, color, sizeof(color));
 
 
 
@@ -220,57 +355,55 @@ glTexImage2D(
 	//=============
 
 	GLuint vertexID = glCreateShader(GL_VERTEX_SHADER);
-	loadShader("TexturedCubeShader.vert", vertexID);
+	bool vertexOK = loadShader("TexturedCubeShader.vert", vertexID);
+	ResourceHandle vertexShader = resources.add(RESOURCE_SHADER, "", vertexID, 0);
 
 
 	GLuint fragID = glCreateShader(GL_FRAGMENT_SHADER);
-	loadShader("TexturedCubeShader.frag", fragID);
+	bool fragOK = loadShader("TexturedCubeShader.frag", fragID);
+	ResourceHandle fragShader = resources.add(RESOURCE_SHADER, "", fragID, 0);
+
+	if(!vertexOK || !fragOK) {
+		resources.release(vertexShader);
+		resources.release(fragShader);
+		return false;
+	}
 
 
 	//=================
 	// PROGRAM LINKING
 	//=================
 
-	programID = glCreateProgram();
+	GLuint programID = glCreateProgram();
+	program = resources.add(RESOURCE_PROGRAM, "", programID, 0);
 	glAttachShader(programID, vertexID);
 	glAttachShader(programID, fragID);
 	glLinkProgram(programID);
 	glGetProgramiv(programID, GL_LINK_STATUS, &linkOK);
-	if(!linkOK) {
-		std::cerr << " ERROR: Could not link program!\n";
-		return false;
-	}
 
-	//==========
-	//ATTRIBUTES
-	//==========
+	//the program keeps what it needs, the shader objects can go once it's linked
+	glDetachShader(programID, vertexID);
+	glDetachShader(programID, fragID);
+	resources.release(vertexShader);
+	resources.release(fragShader);
 
-	const char* attributeName = "coord3d";
-	attribute_coord3d = glGetAttribLocation(programID, attributeName);
-	if(attribute_coord3d == -1) {
-		std::cerr << "Could not bind attribute: " << attributeName << std::endl;
+	if(!linkOK) {
+		std::cerr << " ERROR: Could not link program!\n";
 		return false;
 	}
 
+	//=====================
+	//ATTRIBUTES & UNIFORMS
+	//=====================
 
-	attributeName = "texcoord";
-	attribute_texcoord = glGetAttribLocation(programID, attributeName);
-	if(attribute_texcoord == -1) {
-		std::cerr << "Could not bind attribute: " << attributeName << std::endl;
+	if(!findLocations(programID)) {
 		return false;
 	}
 
-	//========
-	//UNIFORMS
-	//========
-
-	const char* uniformName = "mvp";
-	uniform_mvp = glGetUniformLocation(programID, uniformName);
-	if(uniform_mvp == -1) {
-		std::cerr << "Could not bind uniform: " << uniformName << std::endl;
-		return false;
+	//from here on, saving either shader file rebuilds the program in the background
+	if(shaderReloader.watch("TexturedCubeShader.vert", "TexturedCubeShader.frag", findLocations)) {
+		std::cout << "Watching TexturedCubeShader.vert and TexturedCubeShader.frag for changes\n";
 	}
-
 	return true;
 }
 
@@ -279,7 +412,7 @@ void render(SDL_Window* window) {
 	//texture the cube
     glActiveTexture(GL_TEXTURE0);
     glUniform1i(uniform_myTexture, 0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    glBindTexture(GL_TEXTURE_2D, resources.get(texture));
 
 	//clear the background to black
 	glClearColor(0.0, 0.0, 0.0, 1.0);
@@ -287,8 +420,8 @@ void render(SDL_Window* window) {
     glEnable(GL_DEPTH_TEST);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glUseProgram(programID);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
+	glUseProgram(resources.get(program));
+	glBindBuffer(GL_ARRAY_BUFFER, resources.get(vbo_verticies));
 	glEnableVertexAttribArray(attribute_coord3d);
 
 	glVertexAttribPointer(
@@ -302,12 +435,12 @@ void render(SDL_Window* window) {
 
 	//TEXTURES
 	glEnableVertexAttribArray(attribute_texcoord);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_texcoords);
+	glBindBuffer(GL_ARRAY_BUFFER, resources.get(vbo_texcoords));
 	glVertexAttribPointer(attribute_texcoord, 2, GL_FLOAT, GL_FALSE, 0, 0);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
 
 	//draw the cube
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, resources.get(ibo_elements));
 	int bufferSize;
 	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferSize);
 	glDrawElements(GL_TRIANGLES, bufferSize/sizeof(GLushort), GL_UNSIGNED_SHORT, 0);
@@ -336,21 +469,38 @@ void logic() {
 	glm::rotate(glm::mat4(1.0), glm::radians(angle)*4.0f, axisZ);
 
 	//elements of the mvp matrix
-	glm::mat4 model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0, 0.0, -4.0));
-	glm::mat4 view = glm::lookAt(glm::vec3(0.0, 2.0, 0.0), glm::vec3(0.0, 0.0, -4.0), glm::vec3(0.0, 1.0, 0.0));
+	glm::vec3 eye(0.0, 2.0, 0.0);
+	glm::vec3 cubeCenter(0.0, 0.0, -cubeDistance);
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), cubeCenter);
+	glm::mat4 view = glm::lookAt(eye, cubeCenter, glm::vec3(0.0, 1.0, 0.0));
 	//project at a 45 degree FOV
 	//parameters are the angle (in radians), the aspect ratio, the near clip plane and the far clip plane.
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f * screenWidth / screenHeight, 0.1f, 10.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(fieldOfView), 1.0f * screenWidth / screenHeight, 0.1f, 100.0f);
+
+	//texture streaming feedback: how many pixels does a 2 unit wide cube face cover at this distance?
+	float distance = glm::length(cubeCenter - eye);
+	float projectedPixels = 2.0f / (2.0f * distance * std::tan(glm::radians(fieldOfView) / 2.0f)) * screenHeight;
+	streamer.request(crateTexture, TextureStreamer::lodForCoverage((float)streamer.width(crateTexture), projectedPixels));
 
 	//model view projection matrix, with rotation
 	glm::mat4 mvp = projection * view * model * animation;
 
-	glUseProgram(programID);
+	glUseProgram(resources.get(program));
 
 	//tell OpenGL where the uniform matrix is in the shader. (mvp, in this case)
 	glUniformMatrix4fv(uniform_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
 }
 
+//the viewport and aspect ratio follow the window
+//the size comes from the drawable, in pixels: the window event's size is in window coordinates, which differ on HiDPI screens.
+void resize(SDL_Window* window) {
+	int width, height;
+	SDL_GL_GetDrawableSize(window, &width, &height);
+	screenWidth = std::max(1, width);
+	screenHeight = std::max(1, height);
+	glViewport(0, 0, screenWidth, screenHeight);
+}
+
 //loop and process events
 void mainLoop(SDL_Window* window) {
 	while(true) {
@@ -358,28 +508,75 @@ void mainLoop(SDL_Window* window) {
 		while(SDL_PollEvent(&event)) {
 			if(event.type == SDL_QUIT) {
 				return;
+			} else if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+				resize(window);
 			} else if(event.type == SDL_KEYDOWN) {
 			//if the end key is pressed, end the program
 				switch(event.key.keysym.sym) {
 					case SDLK_END:
 					exit(0);
 					break;
+					//print GPU memory use
+					case SDLK_m:
+					resources.printStats();
+					streamer.printStats();
+					break;
+					//move the cube towards or away from the camera
+					case SDLK_UP:
+					cubeDistance = std::max(2.5f, cubeDistance / 1.25f);
+					break;
+					case SDLK_DOWN:
+					cubeDistance = std::min(90.0f, cubeDistance * 1.25f);
+					break;
 				}
 			}
 		}
+		//never waits for the compiler, a rebuilt program is only swapped in once it has linked.
+		//Runs before logic() so a new program gets its uniforms set before it's drawn with.
+		shaderReloader.update(program);
 		logic();
 		render(window);
+		streamer.update();
+		resources.endFrame();
 	}
 }
 
 //clean up used memory
 void freeResources() {
-	glDeleteProgram(programID);
-	glDeleteBuffers(1, &vbo_verticies);
-	glDeleteTextures(1, &textureID);
+	shaderReloader.stop();
+	resources.release(program);
+	resources.release(texture);
+	resources.release(vbo_verticies);
+	resources.release(vbo_color);
+	resources.release(vbo_texcoords);
+	resources.release(ibo_elements);
+	resources.printStats();
+	streamer.printStats();
+	resources.shutdown();
+	jobs.stop();
 }
 
-int main() {
+int main(int argc, char** argv) {
+	int decodeCopies = 0;
+	std::vector<std::string> decodeFiles = {"woodenCrate.png"};
+	//--texture-budget MB   evict cached textures once they use more than this
+	//--buffer-budget MB    same for vertex and index buffers
+	//--upload-budget KB    most texture data streamed to the GPU per frame
+	//--decode-benchmark N  decode the crate (and any --decode-file images) N times each way against IMG_Load
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+			resources.setBudget(RESOURCE_TEXTURE, (size_t)(atof(argv[++i]) * 1024 * 1024));
+		} else if(strcmp(argv[i], "--buffer-budget") == 0 && i + 1 < argc) {
+			resources.setBudget(RESOURCE_BUFFER, (size_t)(atof(argv[++i]) * 1024 * 1024));
+		} else if(strcmp(argv[i], "--upload-budget") == 0 && i + 1 < argc) {
+			streamer.setUploadBudget((size_t)(atof(argv[++i]) * 1024));
+		} else if(strcmp(argv[i], "--decode-benchmark") == 0 && i + 1 < argc) {
+			decodeCopies = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--decode-file") == 0 && i + 1 < argc) {
+			decodeFiles.push_back(argv[++i]);
+		}
+	}
+
 	SDL_Init(SDL_INIT_EVERYTHING);
 	SDL_Window* window = SDL_CreateWindow("First Texture", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, screenWidth, screenHeight, SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL);
 	SDL_GL_CreateContext(window);
@@ -394,11 +591,17 @@ int main() {
 		exit(1);
 	}
 
+	jobs.start(std::max(1, (int)std::thread::hardware_concurrency()) - 1);
+	if(decodeCopies > 0) {
+		decodeBenchmark(decodeFiles, decodeCopies);
+	}
+
 	if(!initResources()) {
 		std::cerr << "initResources failed!\n";
 		exit(1);
 	}
-
+	//the window may not have been given the size we asked for
+	resize(window);
 
 	mainLoop(window);
 	freeResources();
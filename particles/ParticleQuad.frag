@@ -0,0 +1,8 @@
+#version 130
+in float f_life;
+
+void main(void) {
+	//white hot when born, fading to dull red. Blending is additive, so keep each particle faint.
+	vec3 color = mix(vec3(0.6, 0.1, 0.0), vec3(1.0, 0.9, 0.6), f_life);
+	gl_FragColor = vec4(color * 0.2, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 130
+//firstQuad's quad, shrunk down and drawn once per particle
+in vec2 coord2d;
+//per particle
+in float px;
+in float py;
+in float life;
+uniform float size;
+uniform float lifetime;
+out float f_life;
+
+void main(void) {
+	gl_Position = vec4(vec2(px, py) + coord2d * size, 0.0, 1.0);
+	f_life = clamp(life / lifetime, 0.0, 1.0);
+}
@@ -0,0 +1,285 @@
+/*
+	CPU particle simulation, stored as structure of arrays so eight particles fit in one AVX register.
+
+	Each array (x, y, velocity x, velocity y, life) has its own aligned block, padded to a whole number of
+	8-float vectors. simulate() splits the particles into chunks and hands them to the job system. Each chunk
+	integrates its particles and packs the survivors to the front of the chunk in the same pass: the alive mask
+	of each group of eight picks a permutation from a table, and the permuted vectors are stored at the chunk's
+	write position. The chunks are then slid down next to each other, so the live particles stay in one
+	contiguous run that can be uploaded as is. emit() appends new particles the same way, chunk by chunk,
+	with an xorshift generator running in each lane.
+
+	The AVX2 paths are used when the compiler targets AVX2 (g++ -mavx2). Otherwise the same loops run one
+	particle at a time.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "../firstCube/JobSystem.h"
+
+struct ParticleEmitter {
+	float x, y;       //where particles start
+	float speed;      //upwards speed
+	float spread;     //sideways speed, as a fraction of speed
+	float lifetime;   //longest a particle lives, in seconds. Each one lives between half that and all of it.
+};
+
+class ParticleSystem {
+public:
+	//particles per job. A multiple of 8 so every chunk starts on a whole vector.
+	static const size_t CHUNK_SIZE = 16384;
+
+	~ParticleSystem() {
+		shutdown();
+	}
+
+	bool init(size_t capacity) {
+		shutdown();
+		//room for a whole vector past the end, so the last group of eight can always be loaded and stored
+		size_t padded = (capacity + 15) / 8 * 8;
+		for(float* &array : arrays) {
+			array = static_cast<float*>(std::aligned_alloc(32, padded * sizeof(float)));
+			if(array == nullptr) {
+				return false;
+			}
+			memset(array, 0, padded * sizeof(float));
+		}
+		maxParticles = capacity;
+		chunkAlive = static_cast<size_t*>(std::malloc((capacity / CHUNK_SIZE + 2) * sizeof(size_t)));
+		buildPackTable();
+		return chunkAlive != nullptr;
+	}
+
+	void shutdown() {
+		for(float* &array : arrays) {
+			std::free(array);
+			array = nullptr;
+		}
+		std::free(chunkAlive);
+		chunkAlive = nullptr;
+		maxParticles = particleCount = 0;
+	}
+
+	//add up to count particles, fewer if that would go over the capacity. Returns how many were added.
+	size_t emit(size_t count, const ParticleEmitter &emitter, uint32_t seed, JobSystem* jobs) {
+		count = std::min(count, maxParticles - particleCount);
+		size_t first = particleCount;
+		jobs->parallelFor(count, CHUNK_SIZE, [&](size_t begin, size_t end) {
+			emitRange(first + begin, first + end, emitter, seed);
+		});
+		particleCount += count;
+		return count;
+	}
+
+	//move every particle on by dt and remove the ones that have died
+	void simulate(float dt, float gravity, JobSystem* jobs) {
+		size_t chunks = (particleCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		size_t count = particleCount;
+		jobs->parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+			for(size_t chunk = begin; chunk < end; chunk++) {
+				size_t first = chunk * CHUNK_SIZE;
+				chunkAlive[chunk] = simulateRange(first, std::min(count, first + CHUNK_SIZE), dt, gravity);
+			}
+		});
+
+		//close the gaps between chunks. Each chunk only moves down, so memmove in chunk order is safe.
+		size_t alive = chunks > 0 ? chunkAlive[0] : 0;
+		for(size_t chunk = 1; chunk < chunks; chunk++) {
+			if(chunkAlive[chunk] > 0 && alive != chunk * CHUNK_SIZE) {
+				for(float* array : arrays) {
+					memmove(array + alive, array + chunk * CHUNK_SIZE, chunkAlive[chunk] * sizeof(float));
+				}
+			}
+			alive += chunkAlive[chunk];
+		}
+		particleCount = alive;
+	}
+
+	size_t size() const {
+		return particleCount;
+	}
+
+	size_t capacity() const {
+		return maxParticles;
+	}
+
+	const float* x() const { return arrays[POSITION_X]; }
+	const float* y() const { return arrays[POSITION_Y]; }
+	const float* velocityX() const { return arrays[VELOCITY_X]; }
+	const float* velocityY() const { return arrays[VELOCITY_Y]; }
+	const float* life() const { return arrays[LIFE]; }
+
+private:
+	enum { POSITION_X, POSITION_Y, VELOCITY_X, VELOCITY_Y, LIFE, ARRAY_COUNT };
+
+	//particles bounce off the bottom of the screen, losing half their speed
+	static constexpr float FLOOR = -1.0f;
+	static constexpr float BOUNCE = -0.5f;
+
+	//for each 8-bit alive mask, the lanes to gather so the live ones end up at the front
+	void buildPackTable() {
+		for(int mask = 0; mask < 256; mask++) {
+			int lane = 0;
+			for(int bit = 0; bit < 8; bit++) {
+				if(mask & (1 << bit)) {
+					packTable[mask][lane++] = bit;
+				}
+			}
+			while(lane < 8) {
+				packTable[mask][lane++] = 0;
+			}
+		}
+	}
+
+	static uint32_t xorshift(uint32_t &state) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	static float random01(uint32_t &state) {
+		return (xorshift(state) >> 8) * (1.0f / 16777216.0f);
+	}
+
+#if defined(__AVX2__)
+	//eight xorshift generators side by side, turned into floats in [0, 1) through the mantissa bits
+	static __m256 random01(__m256i &state) {
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+		state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+		__m256i mantissa = _mm256_or_si256(_mm256_srli_epi32(state, 9), _mm256_set1_epi32(0x3f800000));
+		return _mm256_sub_ps(_mm256_castsi256_ps(mantissa), _mm256_set1_ps(1.0f));
+	}
+
+	void emitRange(size_t begin, size_t end, const ParticleEmitter &emitter, uint32_t seed) {
+		//a different stream per lane and per chunk. xorshift must never start at 0.
+		__m256i state = _mm256_set_epi32(8, 7, 6, 5, 4, 3, 2, 1);
+		state = _mm256_mullo_epi32(_mm256_add_epi32(state, _mm256_set1_epi32((int)(seed ^ (uint32_t)begin))),
+			_mm256_set1_epi32((int)0x9E3779B9u));
+		state = _mm256_or_si256(state, _mm256_set1_epi32(1));
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 sideways = _mm256_set1_ps(emitter.speed * emitter.spread * 2.0f);
+		const __m256 speed = _mm256_set1_ps(emitter.speed);
+		const __m256 lifetime = _mm256_set1_ps(emitter.lifetime);
+		const __m256 emitterX = _mm256_set1_ps(emitter.x), emitterY = _mm256_set1_ps(emitter.y);
+		const __m256 jitter = _mm256_set1_ps(0.02f);
+		for(size_t i = begin; i < end; i += 8) {
+			__m256 r0 = random01(state), r1 = random01(state), r2 = random01(state), r3 = random01(state);
+			__m256 values[ARRAY_COUNT];
+			values[POSITION_X] = _mm256_add_ps(emitterX, _mm256_mul_ps(_mm256_sub_ps(r0, half), jitter));
+			values[POSITION_Y] = emitterY;
+			values[VELOCITY_X] = _mm256_mul_ps(_mm256_sub_ps(r1, half), sideways);
+			values[VELOCITY_Y] = _mm256_mul_ps(speed, _mm256_add_ps(half, _mm256_mul_ps(r2, half)));
+			values[LIFE] = _mm256_mul_ps(lifetime, _mm256_add_ps(half, _mm256_mul_ps(r3, half)));
+			if(end - i >= 8) {
+				for(int array = 0; array < ARRAY_COUNT; array++) {
+					_mm256_storeu_ps(arrays[array] + i, values[array]);
+				}
+			} else {
+				//the slots past end can belong to another job that is writing them at the same time,
+				//so the last few particles are copied out of the vector one by one
+				alignas(32) float lanes[8];
+				for(int array = 0; array < ARRAY_COUNT; array++) {
+					_mm256_store_ps(lanes, values[array]);
+					memcpy(arrays[array] + i, lanes, (end - i) * sizeof(float));
+				}
+			}
+		}
+	}
+
+	//integrate [begin, end) and pack the survivors to begin. Returns how many survived.
+	size_t simulateRange(size_t begin, size_t end, float dt, float gravity) {
+		const __m256 step = _mm256_set1_ps(dt);
+		const __m256 fall = _mm256_set1_ps(gravity * dt);
+		const __m256 floor = _mm256_set1_ps(FLOOR);
+		const __m256 bounce = _mm256_set1_ps(BOUNCE);
+		const __m256 zero = _mm256_setzero_ps();
+		float* px = arrays[POSITION_X];
+		float* py = arrays[POSITION_Y];
+		float* vx = arrays[VELOCITY_X];
+		float* vy = arrays[VELOCITY_Y];
+		float* life = arrays[LIFE];
+
+		size_t write = begin;
+		for(size_t i = begin; i < end; i += 8) {
+			__m256 x = _mm256_load_ps(px + i), y = _mm256_load_ps(py + i);
+			__m256 velX = _mm256_load_ps(vx + i), velY = _mm256_load_ps(vy + i);
+			__m256 l = _mm256_load_ps(life + i);
+
+			velY = _mm256_add_ps(velY, fall);
+			x = _mm256_add_ps(x, _mm256_mul_ps(velX, step));
+			y = _mm256_add_ps(y, _mm256_mul_ps(velY, step));
+			__m256 below = _mm256_cmp_ps(y, floor, _CMP_LT_OQ);
+			y = _mm256_blendv_ps(y, floor, below);
+			velY = _mm256_blendv_ps(velY, _mm256_mul_ps(velY, bounce), below);
+			l = _mm256_sub_ps(l, step);
+
+			int alive = _mm256_movemask_ps(_mm256_cmp_ps(l, zero, _CMP_GT_OQ));
+			if(end - i < 8) {
+				alive &= (1 << (end - i)) - 1; //lanes past the end aren't particles
+			}
+			//write <= i, so these stores only touch slots that have already been loaded
+			__m256i pack = _mm256_load_si256(reinterpret_cast<const __m256i*>(packTable[alive]));
+			_mm256_storeu_ps(px + write, _mm256_permutevar8x32_ps(x, pack));
+			_mm256_storeu_ps(py + write, _mm256_permutevar8x32_ps(y, pack));
+			_mm256_storeu_ps(vx + write, _mm256_permutevar8x32_ps(velX, pack));
+			_mm256_storeu_ps(vy + write, _mm256_permutevar8x32_ps(velY, pack));
+			_mm256_storeu_ps(life + write, _mm256_permutevar8x32_ps(l, pack));
+			write += _mm_popcnt_u32((unsigned)alive);
+		}
+		return write - begin;
+	}
+#else
+	void emitRange(size_t begin, size_t end, const ParticleEmitter &emitter, uint32_t seed) {
+		uint32_t state = ((seed ^ (uint32_t)begin) * 0x9E3779B9u) | 1;
+		for(size_t i = begin; i < end; i++) {
+			arrays[POSITION_X][i] = emitter.x + (random01(state) - 0.5f) * 0.02f;
+			arrays[POSITION_Y][i] = emitter.y;
+			arrays[VELOCITY_X][i] = (random01(state) - 0.5f) * emitter.speed * emitter.spread * 2.0f;
+			arrays[VELOCITY_Y][i] = emitter.speed * (0.5f + 0.5f * random01(state));
+			arrays[LIFE][i] = emitter.lifetime * (0.5f + 0.5f * random01(state));
+		}
+	}
+
+	size_t simulateRange(size_t begin, size_t end, float dt, float gravity) {
+		float* px = arrays[POSITION_X];
+		float* py = arrays[POSITION_Y];
+		float* vx = arrays[VELOCITY_X];
+		float* vy = arrays[VELOCITY_Y];
+		float* life = arrays[LIFE];
+		size_t write = begin;
+		for(size_t i = begin; i < end; i++) {
+			float velY = vy[i] + gravity * dt;
+			float x = px[i] + vx[i] * dt;
+			float y = py[i] + velY * dt;
+			if(y < FLOOR) {
+				y = FLOOR;
+				velY *= BOUNCE;
+			}
+			float l = life[i] - dt;
+			if(l > 0.0f) {
+				px[write] = x;
+				py[write] = y;
+				vx[write] = vx[i];
+				vy[write] = velY;
+				life[write] = l;
+				write++;
+			}
+		}
+		return write - begin;
+	}
+#endif
+
+	float* arrays[ARRAY_COUNT] = {};
+	size_t maxParticles = 0, particleCount = 0;
+	size_t* chunkAlive = nullptr; //survivors in each chunk after the last simulate()
+	alignas(32) int32_t packTable[256][8];
+};
@@ -0,0 +1,58 @@
+#version 130
+//one step of the simulation per vertex, written back out with transform feedback.
+//Dead particles are reborn at the emitter in place, so the buffer never needs compacting.
+in vec2 position;
+in vec2 velocity;
+in float life;
+out vec2 outPosition;
+out vec2 outVelocity;
+out float outLife;
+
+uniform float dt;
+uniform float gravity;
+uniform vec2 emitter;
+uniform float speed;
+uniform float spread;
+uniform float lifetime;
+uniform uint frame;
+
+uint hash(uint x) {
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+//[0, 1)
+float random01(inout uint state) {
+	state = hash(state);
+	return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void main(void) {
+	vec2 v = velocity;
+	v.y += gravity * dt;
+	vec2 p = position + v * dt;
+	//bounce off the bottom of the screen
+	if(p.y < -1.0) {
+		p.y = -1.0;
+		v.y *= -0.5;
+	}
+	float l = life - dt;
+
+	//same spread as ParticleSystem::emit
+	if(l <= 0.0) {
+		uint state = uint(gl_VertexID) * 1973u + frame * 9277u + 1u;
+		p = vec2(emitter.x + (random01(state) - 0.5) * 0.02, emitter.y);
+		v = vec2((random01(state) - 0.5) * speed * spread * 2.0, speed * (0.5 + 0.5 * random01(state)));
+		l = lifetime * (0.5 + 0.5 * random01(state));
+	}
+
+	outPosition = p;
+	outVelocity = v;
+	outLife = l;
+	//GLSL 1.30 insists on it, even though nothing gets rasterized
+	gl_Position = vec4(p, 0.0, 1.0);
+}
@@ -0,0 +1,537 @@
+/*
+	Program to simulate a million particles (or as many as --particles asks for) spraying out of a fountain.
+	Press G to switch between simulating them on the CPU and on the GPU.
+	The CPU mode keeps them in ParticleSystem's arrays, integrates, emits and removes them across the job
+	system's threads, and uploads the positions every frame. The GPU mode keeps them in a buffer and steps them
+	with a vertex shader whose output is captured with transform feedback into a second buffer, swapping the two
+	every frame, so nothing crosses the bus. Both modes draw every particle as one of firstQuad's quads, in one
+	instanced draw, and print how many particles per second the simulation gets through.
+	Needs OpenGL 3.1 for transform feedback and instancing. Build with -mavx2 to use ParticleSystem's AVX2 loops.
+*/
+
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "ParticleSystem.h"
+
+//================
+//GLOBAL VARIABLES
+//================
+GLuint renderProgram, updateProgram;
+GLint uniform_size, uniform_render_lifetime;
+GLint uniform_dt, uniform_gravity, uniform_emitter, uniform_speed, uniform_spread, uniform_update_lifetime, uniform_frame;
+
+//attribute locations, fixed before linking
+enum {
+	ATTRIBUTE_COORD2D = 0,
+	ATTRIBUTE_PX = 1,
+	ATTRIBUTE_PY = 2,
+	ATTRIBUTE_LIFE = 3
+};
+enum {
+	ATTRIBUTE_POSITION = 0,
+	ATTRIBUTE_VELOCITY = 1,
+	ATTRIBUTE_STATE_LIFE = 2
+};
+
+//a 3.1 context without ARB_compatibility won't take attribute pointers unless a vertex array object is bound
+GLuint vao;
+
+//the corners of the quad
+GLuint vbo_corners;
+
+//cpu mode: x, y and life arrays one after the other, refilled every frame
+GLuint vbo_cpu_particles;
+
+//gpu mode: read from one, write into the other, then swap
+struct GpuParticle {
+	float x, y;
+	float velocityX, velocityY;
+	float life;
+};
+GLuint vbo_gpu_particles[2];
+int gpuSource = 0;
+GLuint updateQuery[4];
+size_t queryParticles[4]; //particles updated in the pass each query timed
+int nextQuery = 0, queriesIssued = 0;
+//time the update pass on the cpu clock between two glFinish calls instead of with timer queries. Slower, but
+//software renderers do the vertex work outside the query and report next to nothing.
+bool finishTiming = false;
+
+int screenWidth = 800;
+int screenHeight = 600;
+
+JobSystem jobs;
+ParticleSystem particles;
+size_t particleCount = 1000000;
+bool gpuSimulation = false;
+
+//every frame moves the simulation on by the same step, so both modes do the same work whatever the frame rate
+const float timeStep = 1.0f / 60.0f;
+const float gravity = -1.5f;
+const float particleSize = 0.004f;
+const ParticleEmitter fountain = { 0.0f, -1.0f, 1.8f, 0.25f, 3.0f };
+//particles live three quarters of the lifetime on average, emitting at this rate keeps particleCount alive
+float emitPerStep;
+float emitCarry = 0.0f;
+uint32_t frameNumber = 0;
+
+//per frame timings, in milliseconds
+double simulateTime = 0.0, uploadTime = 0.0, gpuSimulateTime = 0.0;
+//not every gpu update gets timed, so its throughput only counts the ones that did
+int gpuTimedFrames = 0;
+size_t gpuTimedParticles = 0;
+
+//============
+// SHADERS
+//============
+
+bool loadShader(const std::string &shaderFile, GLuint id) {
+	std::ifstream file(shaderFile, std::ios::binary | std::ios::ate);
+	if(file.fail()) {
+		perror(shaderFile.c_str());
+		return false;
+	}
+	std::string fileContents(file.tellg(), '\0');
+	file.seekg(0);
+	file.read(&fileContents[0], fileContents.size());
+	file.close();
+
+	const char* contentsPtr = fileContents.c_str();
+	glShaderSource(id, 1, &contentsPtr, NULL);
+	glCompileShader(id);
+	GLint compileOK = GL_FALSE;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &compileOK);
+
+	//if compilation failed, print a detailed error message.
+	if(!compileOK) {
+		std::cerr << "ERROR: " << shaderFile << " FAILED TO COMPILE\n";
+		GLint maxLength = 0;
+		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &maxLength);
+		std::vector<char> errorLog(maxLength + 1);
+		glGetShaderInfoLog(id, maxLength, &maxLength, &errorLog[0]);
+		std::printf("%s\n", &errorLog[0]);
+		return false;
+	}
+	return true;
+}
+
+//link the shaders that have been attached to programID, then let them go
+bool linkProgram(GLuint programID, const char* name) {
+	glLinkProgram(programID);
+	GLint linkOK = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkOK);
+	if(!linkOK) {
+		std::cerr << "ERROR: " << name << " FAILED TO LINK\n";
+		GLint maxLength = 0;
+		glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &maxLength);
+		std::vector<char> errorLog(maxLength + 1);
+		glGetProgramInfoLog(programID, maxLength, &maxLength, &errorLog[0]);
+		std::printf("%s\n", &errorLog[0]);
+		return false;
+	}
+	return true;
+}
+
+bool loadPrograms() {
+	GLuint vertexID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint fragID = glCreateShader(GL_FRAGMENT_SHADER);
+	GLuint updateID = glCreateShader(GL_VERTEX_SHADER);
+	bool ok = loadShader("ParticleQuad.vert", vertexID) && loadShader("ParticleQuad.frag", fragID) &&
+		loadShader("ParticleUpdate.vert", updateID);
+
+	if(ok) {
+		renderProgram = glCreateProgram();
+		glAttachShader(renderProgram, vertexID);
+		glAttachShader(renderProgram, fragID);
+		glBindAttribLocation(renderProgram, ATTRIBUTE_COORD2D, "coord2d");
+		glBindAttribLocation(renderProgram, ATTRIBUTE_PX, "px");
+		glBindAttribLocation(renderProgram, ATTRIBUTE_PY, "py");
+		glBindAttribLocation(renderProgram, ATTRIBUTE_LIFE, "life");
+		ok = linkProgram(renderProgram, "particle quad program");
+		glDetachShader(renderProgram, vertexID);
+		glDetachShader(renderProgram, fragID);
+	}
+
+	if(ok) {
+		//the update program has no fragment shader, its output only goes to the transform feedback buffer
+		updateProgram = glCreateProgram();
+		glAttachShader(updateProgram, updateID);
+		glBindAttribLocation(updateProgram, ATTRIBUTE_POSITION, "position");
+		glBindAttribLocation(updateProgram, ATTRIBUTE_VELOCITY, "velocity");
+		glBindAttribLocation(updateProgram, ATTRIBUTE_STATE_LIFE, "life");
+		//written out in the same layout as GpuParticle
+		const char* varyings[] = {"outPosition", "outVelocity", "outLife"};
+		glTransformFeedbackVaryings(updateProgram, 3, varyings, GL_INTERLEAVED_ATTRIBS);
+		ok = linkProgram(updateProgram, "particle update program");
+		glDetachShader(updateProgram, updateID);
+	}
+
+	glDeleteShader(vertexID);
+	glDeleteShader(fragID);
+	glDeleteShader(updateID);
+	if(!ok) {
+		return false;
+	}
+
+	uniform_size = glGetUniformLocation(renderProgram, "size");
+	uniform_render_lifetime = glGetUniformLocation(renderProgram, "lifetime");
+	uniform_dt = glGetUniformLocation(updateProgram, "dt");
+	uniform_gravity = glGetUniformLocation(updateProgram, "gravity");
+	uniform_emitter = glGetUniformLocation(updateProgram, "emitter");
+	uniform_speed = glGetUniformLocation(updateProgram, "speed");
+	uniform_spread = glGetUniformLocation(updateProgram, "spread");
+	uniform_update_lifetime = glGetUniformLocation(updateProgram, "lifetime");
+	uniform_frame = glGetUniformLocation(updateProgram, "frame");
+	return true;
+}
+
+bool initResources() {
+
+	if(!GLEW_VERSION_3_1) {
+		std::cerr << "Transform feedback and instancing need OpenGL 3.1\n";
+		return false;
+	}
+	if(!loadPrograms()) {
+		return false;
+	}
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	//the same corners as firstQuad, as a strip
+	GLfloat corners[] = {
+		-1.0, -1.0,
+		 1.0, -1.0,
+		-1.0,  1.0,
+		 1.0,  1.0
+	};
+	glGenBuffers(1, &vbo_corners);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_corners);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	//room for the odd frame where more are born than die
+	if(!particles.init(particleCount + particleCount / 4)) {
+		std::cerr << "Not enough memory for " << particleCount << " particles\n";
+		return false;
+	}
+	emitPerStep = particleCount * timeStep / (fountain.lifetime * 0.75f);
+	//start with the fountain already full
+	particles.emit(particleCount, fountain, frameNumber++, &jobs);
+
+	glGenBuffers(1, &vbo_cpu_particles);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_cpu_particles);
+	glBufferData(GL_ARRAY_BUFFER, particles.capacity() * 3 * sizeof(float), NULL, GL_STREAM_DRAW);
+
+	//the gpu starts from the same particles
+	std::vector<GpuParticle> start(particleCount);
+	for(size_t i = 0; i < particleCount; i++) {
+		start[i] = {particles.x()[i], particles.y()[i], particles.velocityX()[i], particles.velocityY()[i], particles.life()[i]};
+	}
+	glGenBuffers(2, vbo_gpu_particles);
+	for(int i = 0; i < 2; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_gpu_particles[i]);
+		glBufferData(GL_ARRAY_BUFFER, start.size() * sizeof(GpuParticle), start.data(), GL_DYNAMIC_COPY);
+	}
+
+	if(GLEW_ARB_timer_query) {
+		glGenQueries(4, updateQuery);
+	} else {
+		finishTiming = true;
+	}
+	return true;
+}
+
+//============
+// SIMULATION
+//============
+
+void simulateCpu() {
+	auto start = std::chrono::steady_clock::now();
+	particles.simulate(timeStep, gravity, &jobs);
+	emitCarry += emitPerStep;
+	size_t born = (size_t)emitCarry;
+	emitCarry -= born;
+	particles.emit(born, fountain, frameNumber, &jobs);
+	auto simulated = std::chrono::steady_clock::now();
+
+	//orphan last frame's data rather than wait for the gpu to finish drawing it
+	size_t count = particles.size(), capacity = particles.capacity();
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_cpu_particles);
+	glBufferData(GL_ARRAY_BUFFER, capacity * 3 * sizeof(float), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(float), particles.x());
+	glBufferSubData(GL_ARRAY_BUFFER, capacity * sizeof(float), count * sizeof(float), particles.y());
+	glBufferSubData(GL_ARRAY_BUFFER, capacity * 2 * sizeof(float), count * sizeof(float), particles.life());
+	auto uploaded = std::chrono::steady_clock::now();
+
+	simulateTime += std::chrono::duration<double, std::milli>(simulated - start).count();
+	uploadTime += std::chrono::duration<double, std::milli>(uploaded - simulated).count();
+}
+
+//read back timer queries that have finished, without waiting for the ones that haven't
+void readGpuTimes() {
+	while(queriesIssued > 0) {
+		int query = (nextQuery - queriesIssued + 4) % 4;
+		GLint available = 0;
+		glGetQueryObjectiv(updateQuery[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available) {
+			break;
+		}
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(updateQuery[query], GL_QUERY_RESULT, &nanoseconds);
+		//some drivers hand back garbage for the first query
+		if(nanoseconds < 1000000000ull) {
+			gpuSimulateTime += nanoseconds / 1000000.0;
+			gpuTimedFrames++;
+			gpuTimedParticles += queryParticles[query];
+		}
+		queriesIssued--;
+	}
+}
+
+void simulateGpu() {
+	glUseProgram(updateProgram);
+	glUniform1f(uniform_dt, timeStep);
+	glUniform1f(uniform_gravity, gravity);
+	glUniform2f(uniform_emitter, fountain.x, fountain.y);
+	glUniform1f(uniform_speed, fountain.speed);
+	glUniform1f(uniform_spread, fountain.spread);
+	glUniform1f(uniform_update_lifetime, fountain.lifetime);
+	glUniform1ui(uniform_frame, frameNumber);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_gpu_particles[gpuSource]);
+	glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+	glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, x));
+	glEnableVertexAttribArray(ATTRIBUTE_VELOCITY);
+	glVertexAttribPointer(ATTRIBUTE_VELOCITY, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, velocityX));
+	glEnableVertexAttribArray(ATTRIBUTE_STATE_LIFE);
+	glVertexAttribPointer(ATTRIBUTE_STATE_LIFE, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, life));
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo_gpu_particles[1 - gpuSource]);
+
+	auto start = std::chrono::steady_clock::now();
+	if(finishTiming) {
+		glFinish();
+		start = std::chrono::steady_clock::now();
+	}
+	//only one query in flight per slot, skip timing this frame if the ring is full
+	bool timed = !finishTiming && queriesIssued < 4;
+	if(timed) {
+		glBeginQuery(GL_TIME_ELAPSED, updateQuery[nextQuery]);
+	}
+	//nothing to rasterize, the vertex shader's output is all we want
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)particleCount);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+	if(timed) {
+		glEndQuery(GL_TIME_ELAPSED);
+		queryParticles[nextQuery] = particleCount;
+		nextQuery = (nextQuery + 1) % 4;
+		queriesIssued++;
+	}
+	if(finishTiming) {
+		glFinish();
+		gpuSimulateTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		gpuTimedFrames++;
+		gpuTimedParticles += particleCount;
+	}
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+	glDisableVertexAttribArray(ATTRIBUTE_VELOCITY);
+	glDisableVertexAttribArray(ATTRIBUTE_STATE_LIFE);
+	gpuSource = 1 - gpuSource;
+	readGpuTimes();
+}
+
+//==========
+// RENDERING
+//==========
+
+void render(SDL_Window* window) {
+	glClearColor(0.0, 0.0, 0.0, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+
+	glUseProgram(renderProgram);
+	glUniform1f(uniform_size, particleSize);
+	glUniform1f(uniform_render_lifetime, fountain.lifetime);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_corners);
+	glEnableVertexAttribArray(ATTRIBUTE_COORD2D);
+	glVertexAttribPointer(ATTRIBUTE_COORD2D, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	//one quad per particle, the particle's attributes step once per instance
+	GLsizei count;
+	if(gpuSimulation) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_gpu_particles[gpuSource]);
+		glVertexAttribPointer(ATTRIBUTE_PX, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, x));
+		glVertexAttribPointer(ATTRIBUTE_PY, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, y));
+		glVertexAttribPointer(ATTRIBUTE_LIFE, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, life));
+		count = (GLsizei)particleCount;
+	} else {
+		size_t capacity = particles.capacity();
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_cpu_particles);
+		glVertexAttribPointer(ATTRIBUTE_PX, 1, GL_FLOAT, GL_FALSE, 0, 0);
+		glVertexAttribPointer(ATTRIBUTE_PY, 1, GL_FLOAT, GL_FALSE, 0, (void*)(capacity * sizeof(float)));
+		glVertexAttribPointer(ATTRIBUTE_LIFE, 1, GL_FLOAT, GL_FALSE, 0, (void*)(capacity * 2 * sizeof(float)));
+		count = (GLsizei)particles.size();
+	}
+	for(GLuint attribute : {ATTRIBUTE_PX, ATTRIBUTE_PY, ATTRIBUTE_LIFE}) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+	for(GLuint attribute : {ATTRIBUTE_PX, ATTRIBUTE_PY, ATTRIBUTE_LIFE}) {
+		glVertexAttribDivisor(attribute, 0);
+		glDisableVertexAttribArray(attribute);
+	}
+	glDisableVertexAttribArray(ATTRIBUTE_COORD2D);
+	glDisable(GL_BLEND);
+
+	//display the result
+	SDL_GL_SwapWindow(window);
+}
+
+//loop and process events
+void mainLoop(SDL_Window* window) {
+	const double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+	double frameTime = 0.0;
+	int frames = 0;
+	size_t particlesSimulated = 0;
+	Uint64 lastFrame = SDL_GetPerformanceCounter();
+
+	while(true) {
+		SDL_Event event;
+		while(SDL_PollEvent(&event)) {
+			if(event.type == SDL_QUIT) {
+				return;
+			} else if(event.type == SDL_KEYDOWN) {
+				switch(event.key.keysym.sym) {
+					//if the end key is pressed, end the program
+					case SDLK_END:
+					exit(0);
+					break;
+					//switch between simulating on the cpu and the gpu
+					case SDLK_g:
+					gpuSimulation = !gpuSimulation;
+					frames = 0;
+					particlesSimulated = 0;
+					frameTime = simulateTime = uploadTime = gpuSimulateTime = 0.0;
+					gpuTimedFrames = 0;
+					gpuTimedParticles = 0;
+					break;
+				}
+			}
+		}
+
+		particlesSimulated += gpuSimulation ? particleCount : particles.size();
+		if(gpuSimulation) {
+			simulateGpu();
+		} else {
+			simulateCpu();
+		}
+		frameNumber++;
+		render(window);
+
+		Uint64 end = SDL_GetPerformanceCounter();
+		frameTime += (end - lastFrame) * msPerCount;
+		lastFrame = end;
+		if(++frames == 120) {
+			double perFrame = (double)particlesSimulated / frames;
+			//timer results trail a few frames behind and frames with every query busy aren't timed, so the gpu
+			//averages are over the passes that were timed rather than over these 120 frames
+			double gpuPerPass = gpuTimedFrames > 0 ? gpuSimulateTime / gpuTimedFrames : 0.0;
+			if(gpuSimulation && !finishTiming && gpuPerPass < 0.001) {
+				std::printf("gpu timer queries report almost nothing, timing the update pass with glFinish from now on\n");
+				finishTiming = true;
+			} else if(gpuSimulation) {
+				std::printf("gpu (transform feedback, %s): %.2fM particles, %.3f ms simulating (%.0fM particles/s, %d passes timed), %.3f ms per frame\n",
+					finishTiming ? "glFinish timing" : "timer queries", perFrame / 1e6, gpuPerPass,
+					gpuTimedParticles / gpuSimulateTime / 1000.0, gpuTimedFrames, frameTime / frames);
+			} else {
+#if defined(__AVX2__)
+				const char* path = "AVX2";
+#else
+				const char* path = "scalar";
+#endif
+				std::printf("cpu (%s, %d threads): %.2fM particles, %.3f ms simulating (%.0fM particles/s), %.3f ms uploading, %.3f ms per frame\n",
+					path, jobs.threadCount(), perFrame / 1e6, simulateTime / frames, perFrame / (simulateTime / frames) / 1000.0,
+					uploadTime / frames, frameTime / frames);
+			}
+			frames = 0;
+			particlesSimulated = 0;
+			frameTime = simulateTime = uploadTime = gpuSimulateTime = 0.0;
+			gpuTimedFrames = 0;
+			gpuTimedParticles = 0;
+		}
+	}
+}
+
+//clean up used memory
+void freeResources() {
+	glDeleteProgram(renderProgram);
+	glDeleteProgram(updateProgram);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo_corners);
+	glDeleteBuffers(1, &vbo_cpu_particles);
+	glDeleteBuffers(2, vbo_gpu_particles);
+	if(GLEW_ARB_timer_query) {
+		glDeleteQueries(4, updateQuery);
+	}
+	particles.shutdown();
+	jobs.stop();
+}
+
+int main(int argc, char** argv) {
+	//--particles N     simulate N particles (default 1000000)
+	//--gpu             start with the gpu simulation (toggle with G)
+	//--finish-timing   time the gpu simulation with glFinish rather than timer queries
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+			particleCount = std::max(1L, atol(argv[++i]));
+		} else if(strcmp(argv[i], "--gpu") == 0) {
+			gpuSimulation = true;
+		} else if(strcmp(argv[i], "--finish-timing") == 0) {
+			finishTiming = true;
+		}
+	}
+
+	SDL_Init(SDL_INIT_EVERYTHING);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+	SDL_Window* window = SDL_CreateWindow("Particles", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, screenWidth, screenHeight, SDL_WINDOW_OPENGL);
+	if(window == nullptr) {
+		std::cerr << SDL_GetError() << std::endl;
+		exit(1);
+	}
+	SDL_GL_CreateContext(window);
+
+	GLenum glewStatus = glewInit();
+	if(glewStatus != GLEW_OK) {
+		std::cerr << glewGetErrorString(glewStatus) << std::endl;
+	}
+
+	jobs.start(std::max(1, (int)std::thread::hardware_concurrency()) - 1);
+	if(!initResources()) {
+		std::cerr << "initResources failed!\n";
+		exit(1);
+	}
+
+	mainLoop(window);
+	freeResources();
+	return 0;
+}
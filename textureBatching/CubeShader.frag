@@ -0,0 +1,28 @@
+#version 130
+#ifdef TEXTURING
+in vec2 f_texcoord;
+#ifdef INSTANCING
+flat in float f_layer;
+uniform sampler2DArray textures;
+#else
+uniform sampler2D textures;
+#endif
+#endif
+#ifdef VERTEX_COLOR
+in vec3 f_color;
+#endif
+
+void main() {
+	vec4 color = vec4(1.0);
+#ifdef TEXTURING
+#ifdef INSTANCING
+	color = texture(textures, vec3(f_texcoord, f_layer));
+#else
+	color = texture(textures, f_texcoord);
+#endif
+#endif
+#ifdef VERTEX_COLOR
+	color.rgb *= f_color;
+#endif
+	gl_FragColor = color;
+}
@@ -0,0 +1,52 @@
+#version 130
+//one source for every variant, the features are switched on with #defines (see ShaderVariants.h)
+in vec3 coord3d;
+#ifdef QUANTIZED_POSITIONS
+uniform float positionScale;
+#endif
+#ifdef TEXTURING
+in vec2 texcoord;
+out vec2 f_texcoord;
+#endif
+#ifdef VERTEX_COLOR
+in vec3 v_color;
+out vec3 f_color;
+#endif
+#ifdef INSTANCING
+//per instance
+in mat4 model;
+uniform mat4 viewProjection;
+#ifdef TEXTURING
+in vec4 uvRect;
+in float layer;
+flat out float f_layer;
+#endif
+#else
+uniform mat4 mvp;
+#endif
+
+void main() {
+#ifdef QUANTIZED_POSITIONS
+	//normalized shorts come in between -1 and 1
+	vec3 position = coord3d * positionScale;
+#else
+	vec3 position = coord3d;
+#endif
+#ifdef INSTANCING
+	gl_Position = viewProjection * model * vec4(position, 1.0);
+#else
+	gl_Position = mvp * vec4(position, 1.0);
+#endif
+#ifdef TEXTURING
+	//flipped so that it's the right way round
+	f_texcoord = vec2(texcoord.x, 1.0 - texcoord.y);
+#ifdef INSTANCING
+	//moved into this instance's rectangle of its layer
+	f_texcoord = uvRect.xy + f_texcoord * uvRect.zw;
+	f_layer = layer;
+#endif
+#endif
+#ifdef VERTEX_COLOR
+	f_color = v_color;
+#endif
+}
@@ -0,0 +1,233 @@
+/*
+	Builds every combination of a shader's optional features up front.
+
+	The shader source is written once with #ifdef blocks for each feature, and each variant is that source
+	with a #define line per feature added after the #version line. Variants are numbered by their feature mask,
+	so picking one at draw time is just indexing an array with the mask:
+
+		const ShaderVariant &shader = variants[FEATURE_INSTANCING | FEATURE_TEXTURING];
+
+	Attribute locations are fixed with glBindAttribLocation before linking so every variant takes its vertex
+	data in the same place, and the uniform locations are looked up once when the variants are built.
+
+	All the compiles and links are issued before any of their results are asked for. Asking for a compile status
+	makes the driver finish that compile there and then, so checking each shader as it is compiled serializes the
+	whole lot. With GL_KHR_parallel_shader_compile the driver compiles on its own threads and we poll
+	GL_COMPLETION_STATUS_KHR until everything is done. Without it, drivers that compile lazily still get the
+	whole batch before they have to block.
+*/
+
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum ShaderFeature : uint32_t {
+	FEATURE_INSTANCING = 1 << 0,          //model matrix and texture rectangle come from per-instance attributes
+	FEATURE_TEXTURING = 1 << 1,           //sample a texture (the shared texture array when instancing)
+	FEATURE_VERTEX_COLOR = 1 << 2,        //multiply by a per-vertex colour
+	FEATURE_QUANTIZED_POSITIONS = 1 << 3  //positions are normalized shorts, scaled back up by positionScale
+};
+constexpr int SHADER_FEATURE_COUNT = 4;
+constexpr uint32_t SHADER_VARIANT_COUNT = 1u << SHADER_FEATURE_COUNT;
+constexpr const char* SHADER_FEATURE_NAMES[SHADER_FEATURE_COUNT] = {
+	"INSTANCING", "TEXTURING", "VERTEX_COLOR", "QUANTIZED_POSITIONS"
+};
+
+//attribute locations shared by every variant. A mat4 attribute takes four locations, one per column.
+enum ShaderAttribute : GLuint {
+	ATTRIBUTE_COORD3D = 0,
+	ATTRIBUTE_TEXCOORD = 1,
+	ATTRIBUTE_V_COLOR = 2,
+	ATTRIBUTE_UV_RECT = 3,
+	ATTRIBUTE_LAYER = 4,
+	ATTRIBUTE_MODEL = 5
+};
+
+struct ShaderVariant {
+	GLuint program = 0;
+	//-1 when the variant doesn't use that uniform
+	GLint mvp = -1, viewProjection = -1, positionScale = -1, textures = -1;
+};
+
+class ShaderVariants {
+public:
+	//compile and link all SHADER_VARIANT_COUNT variants of a vertex and fragment shader.
+	//serial waits for each compile and link before starting the next, the way one-at-a-time loading does.
+	bool build(const std::string &vertexFile, const std::string &fragFile, bool serial = false) {
+		std::string vertexSource, fragSource;
+		if(!readFile(vertexFile, vertexSource) || !readFile(fragFile, fragSource)) {
+			return false;
+		}
+		auto start = std::chrono::steady_clock::now();
+		bool parallel = GLEW_KHR_parallel_shader_compile;
+		if(parallel) {
+			//let the driver use as many threads as it likes
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
+
+		GLuint vertexShaders[SHADER_VARIANT_COUNT], fragShaders[SHADER_VARIANT_COUNT];
+		for(uint32_t features = 0; features < SHADER_VARIANT_COUNT; features++) {
+			vertexShaders[features] = compile(GL_VERTEX_SHADER, vertexSource, features, serial);
+			fragShaders[features] = compile(GL_FRAGMENT_SHADER, fragSource, features, serial);
+		}
+		for(uint32_t features = 0; features < SHADER_VARIANT_COUNT; features++) {
+			GLuint program = glCreateProgram();
+			glAttachShader(program, vertexShaders[features]);
+			glAttachShader(program, fragShaders[features]);
+			glBindAttribLocation(program, ATTRIBUTE_COORD3D, "coord3d");
+			glBindAttribLocation(program, ATTRIBUTE_TEXCOORD, "texcoord");
+			glBindAttribLocation(program, ATTRIBUTE_V_COLOR, "v_color");
+			glBindAttribLocation(program, ATTRIBUTE_UV_RECT, "uvRect");
+			glBindAttribLocation(program, ATTRIBUTE_LAYER, "layer");
+			glBindAttribLocation(program, ATTRIBUTE_MODEL, "model");
+			glLinkProgram(program);
+			if(serial) {
+				GLint linked;
+				glGetProgramiv(program, GL_LINK_STATUS, &linked);
+			}
+			variants[features].program = program;
+		}
+
+		if(parallel && !serial) {
+			//nothing else to do while we wait, but a real loader could keep streaming assets here
+			uint32_t finished = 0;
+			while(finished < SHADER_VARIANT_COUNT) {
+				GLint done = GL_FALSE;
+				glGetProgramiv(variants[finished].program, GL_COMPLETION_STATUS_KHR, &done);
+				if(done) {
+					finished++;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		//only now ask how it went
+		bool ok = true;
+		for(uint32_t features = 0; features < SHADER_VARIANT_COUNT; features++) {
+			GLuint program = variants[features].program;
+			GLint linked = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &linked);
+			if(!linked) {
+				std::cerr << "ERROR: variant " << describe(features) << " of " << vertexFile << " and " << fragFile << " failed\n";
+				printShaderLog(vertexShaders[features]);
+				printShaderLog(fragShaders[features]);
+				printProgramLog(program);
+				ok = false;
+			}
+			glDetachShader(program, vertexShaders[features]);
+			glDetachShader(program, fragShaders[features]);
+			glDeleteShader(vertexShaders[features]);
+			glDeleteShader(fragShaders[features]);
+			if(linked) {
+				variants[features].mvp = glGetUniformLocation(program, "mvp");
+				variants[features].viewProjection = glGetUniformLocation(program, "viewProjection");
+				variants[features].positionScale = glGetUniformLocation(program, "positionScale");
+				variants[features].textures = glGetUniformLocation(program, "textures");
+			}
+		}
+		buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::printf("%u shader variants of %s and %s built in %.2f ms%s\n", SHADER_VARIANT_COUNT, vertexFile.c_str(),
+			fragFile.c_str(), buildTime, serial ? " one at a time" : parallel ? " with parallel compilation" : " in one batch");
+		return ok;
+	}
+
+	const ShaderVariant& operator[](uint32_t features) const {
+		return variants[features % SHADER_VARIANT_COUNT];
+	}
+
+	//wall time of the last build, in milliseconds
+	double compileTime() const {
+		return buildTime;
+	}
+
+	void destroy() {
+		for(ShaderVariant &variant : variants) {
+			glDeleteProgram(variant.program);
+			variant = ShaderVariant();
+		}
+	}
+
+	//"INSTANCING | TEXTURING", for messages
+	static std::string describe(uint32_t features) {
+		std::string names;
+		for(int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+			if(features & (1u << i)) {
+				names += names.empty() ? SHADER_FEATURE_NAMES[i] : std::string(" | ") + SHADER_FEATURE_NAMES[i];
+			}
+		}
+		return names.empty() ? "no features" : names;
+	}
+
+private:
+	static bool readFile(const std::string &fileName, std::string &contents) {
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if(file.fail()) {
+			perror(fileName.c_str());
+			return false;
+		}
+		contents.assign(file.tellg(), '\0');
+		file.seekg(0);
+		file.read(&contents[0], contents.size());
+		return true;
+	}
+
+	//the #version line has to come first, so the defines go straight after it
+	static GLuint compile(GLenum type, const std::string &source, uint32_t features, bool wait) {
+		size_t bodyStart = 0;
+		if(source.compare(0, 8, "#version") == 0) {
+			bodyStart = source.find('\n');
+			bodyStart = bodyStart == std::string::npos ? source.size() : bodyStart + 1;
+		}
+		std::string header = source.substr(0, bodyStart);
+		if(bodyStart > 0 && header.back() != '\n') {
+			header += '\n';
+		}
+		for(int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+			if(features & (1u << i)) {
+				header += std::string("#define ") + SHADER_FEATURE_NAMES[i] + "\n";
+			}
+		}
+		const char* parts[2] = {header.c_str(), source.c_str() + bodyStart};
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 2, parts, NULL);
+		glCompileShader(shader);
+		if(wait) {
+			GLint compiled;
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+		}
+		return shader;
+	}
+
+	static void printShaderLog(GLuint shader) {
+		GLint compiled = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+		if(compiled) {
+			return;
+		}
+		GLint maxLength = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+		std::vector<char> errorLog(maxLength + 1);
+		glGetShaderInfoLog(shader, maxLength, &maxLength, &errorLog[0]);
+		std::printf("%s\n", &errorLog[0]);
+	}
+
+	static void printProgramLog(GLuint program) {
+		GLint maxLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+		std::vector<char> errorLog(maxLength + 1);
+		glGetProgramInfoLog(program, maxLength, &maxLength, &errorLog[0]);
+		std::printf("%s\n", &errorLog[0]);
+	}
+
+	ShaderVariant variants[SHADER_VARIANT_COUNT];
+	double buildTime = 0.0;
+};
@@ -0,0 +1,230 @@
+/*
+	Packs lots of small RGBA textures into one GL_TEXTURE_2D_ARRAY so they can all be drawn with a single bind.
+
+	Textures that are exactly the layer size get a layer each. Anything smaller is packed into shared atlas
+	layers with a shelf packer: rectangles are sorted by height and placed left to right along horizontal
+	shelves. Each packed texture gets a padding border copied from its edge pixels, so linear filtering at
+	the edge of a rectangle doesn't pick up its neighbours.
+
+	Every texture ends up as a TextureRegion: the layer it lives in and the rectangle it covers in that layer,
+	in texture coordinates. The shader turns a 0-1 texcoord into uvRect.xy + texcoord * uvRect.zw.
+
+	A driver only has to allow 256 layers in an array texture (GL_MAX_ARRAY_TEXTURE_LAYERS), so when there are
+	more layers than that they're split over several arrays. A region also says which array it's in, and the
+	caller binds each array once and draws everything that uses it.
+*/
+
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+struct TextureRegion {
+	int array = 0; //which of the builder's array textures
+	int layer = 0; //layer within that array
+	float u = 0.0f, v = 0.0f, width = 1.0f, height = 1.0f;
+};
+
+class TextureArrayBuilder {
+public:
+	TextureArrayBuilder(int layerWidth, int layerHeight, int padding = 1)
+		: layerWidth(layerWidth), layerHeight(layerHeight), padding(padding) {}
+
+	//queue an RGBA8 image. Returns its region index, or -1 if it's bigger than a layer.
+	int add(int width, int height, const unsigned char* pixels) {
+		if(width > layerWidth || height > layerHeight) {
+			std::cerr << "TextureArrayBuilder: " << width << "x" << height << " doesn't fit in a "
+				<< layerWidth << "x" << layerHeight << " layer\n";
+			return -1;
+		}
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+		images.push_back(std::move(image));
+		regions.push_back(TextureRegion());
+		return (int)images.size() - 1;
+	}
+
+	//pack everything added so far and upload it, in as many arrays as the layer limit needs. layerLimit lowers
+	//the driver's limit, to try the split on a driver that allows lots of layers. Returns false on failure.
+	bool build(int layerLimit = 0) {
+		std::vector<int> whole, packed;
+		for(int i = 0; i < (int)images.size(); i++) {
+			if(images[i].width == layerWidth && images[i].height == layerHeight) {
+				whole.push_back(i);
+			} else {
+				packed.push_back(i);
+			}
+		}
+
+		layers.clear();
+		for(int index : whole) {
+			layers.push_back(std::vector<unsigned char>((size_t)layerWidth * layerHeight * 4));
+			blit(index, (int)layers.size() - 1, 0, 0);
+		}
+		fullLayers = (int)layers.size();
+		packShelves(packed);
+
+		if(layers.empty()) {
+			return false;
+		}
+
+		GLint maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		if(layerLimit > 0 && layerLimit < maxLayers) {
+			maxLayers = layerLimit;
+		}
+		if(maxLayers < 1) {
+			std::cerr << "TextureArrayBuilder: the driver doesn't support array textures\n";
+			return false;
+		}
+		for(TextureRegion &region : regions) {
+			region.array = region.layer / maxLayers;
+			region.layer %= maxLayers;
+		}
+
+		for(int first = 0; first < (int)layers.size(); first += maxLayers) {
+			int count = std::min(maxLayers, (int)layers.size() - first);
+			GLuint textureID;
+			glGenTextures(1, &textureID);
+			arrays.push_back(textureID);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerWidth, layerHeight, count, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			GLenum error = glGetError();
+			if(error != GL_NO_ERROR) {
+				std::cerr << "TextureArrayBuilder: couldn't allocate a " << layerWidth << "x" << layerHeight << "x" << count
+					<< " array texture (GL error 0x" << std::hex << error << std::dec << ")\n";
+				destroy();
+				return false;
+			}
+			for(int layer = 0; layer < count; layer++) {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, layerWidth, layerHeight, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, layers[first + layer].data());
+			}
+		}
+		//the CPU copies aren't needed once they're on the GPU
+		images.clear();
+		layers.clear();
+		return true;
+	}
+
+	//the array textures build() made, in region.array order
+	GLuint texture(int array) const {
+		return arrays[array];
+	}
+
+	int arrayCount() const {
+		return (int)arrays.size();
+	}
+
+	void destroy() {
+		glDeleteTextures((GLsizei)arrays.size(), arrays.data());
+		arrays.clear();
+	}
+
+	const TextureRegion& region(int index) const {
+		return regions[index];
+	}
+
+	int layerCount() const {
+		return layerTotal;
+	}
+
+	//layers holding one whole texture each, the rest are atlases
+	int wholeLayerCount() const {
+		return fullLayers;
+	}
+
+private:
+	struct Image {
+		int width, height;
+		std::vector<unsigned char> pixels;
+	};
+
+	struct Shelf {
+		int y, height, x;
+	};
+
+	//tallest first, each one on the first shelf it fits on, opening a new shelf or layer when it doesn't
+	void packShelves(const std::vector<int> &packed) {
+		std::vector<int> order(packed);
+		std::sort(order.begin(), order.end(), [this](int a, int b) { return images[a].height > images[b].height; });
+
+		std::vector<Shelf> shelves;
+		int layer = -1;
+		int nextShelfY = 0;
+		for(int index : order) {
+			int width = std::min(images[index].width + padding * 2, layerWidth);
+			int height = std::min(images[index].height + padding * 2, layerHeight);
+
+			Shelf* shelf = nullptr;
+			for(Shelf &candidate : shelves) {
+				if(candidate.height >= height && candidate.x + width <= layerWidth) {
+					shelf = &candidate;
+					break;
+				}
+			}
+			if(shelf == nullptr) {
+				if(layer == -1 || nextShelfY + height > layerHeight) {
+					layers.push_back(std::vector<unsigned char>((size_t)layerWidth * layerHeight * 4));
+					layer = (int)layers.size() - 1;
+					shelves.clear();
+					nextShelfY = 0;
+				}
+				shelves.push_back(Shelf{nextShelfY, height, 0});
+				nextShelfY += height;
+				shelf = &shelves.back();
+			}
+			blit(index, layer, shelf->x + (width - images[index].width) / 2, shelf->y + (height - images[index].height) / 2);
+			shelf->x += width;
+		}
+		layerTotal = (int)layers.size();
+	}
+
+	//copy an image into a layer and extend its edge pixels into the padding around it
+	void blit(int index, int layer, int x, int y) {
+		const Image &image = images[index];
+		unsigned char* target = layers[layer].data();
+		int pad = image.width == layerWidth && image.height == layerHeight ? 0 : padding;
+		for(int row = -pad; row < image.height + pad; row++) {
+			int targetY = y + row;
+			if(targetY < 0 || targetY >= layerHeight) {
+				continue;
+			}
+			int sourceY = std::min(std::max(row, 0), image.height - 1);
+			for(int column = -pad; column < image.width + pad; column++) {
+				int targetX = x + column;
+				if(targetX < 0 || targetX >= layerWidth) {
+					continue;
+				}
+				int sourceX = std::min(std::max(column, 0), image.width - 1);
+				memcpy(target + ((size_t)targetY * layerWidth + targetX) * 4,
+					image.pixels.data() + ((size_t)sourceY * image.width + sourceX) * 4, 4);
+			}
+		}
+
+		TextureRegion &region = regions[index];
+		region.layer = layer;
+		region.u = (float)x / layerWidth;
+		region.v = (float)y / layerHeight;
+		region.width = (float)image.width / layerWidth;
+		region.height = (float)image.height / layerHeight;
+	}
+
+	int layerWidth, layerHeight, padding;
+	std::vector<Image> images;
+	std::vector<TextureRegion> regions;
+	std::vector<std::vector<unsigned char>> layers;
+	std::vector<GLuint> arrays;
+	int fullLayers = 0;
+	int layerTotal = 0;
+};
@@ -0,0 +1,531 @@
+/*
+	Program to render 1000 cubes that each have their own texture.
+	Press B to switch between binding each cube's texture and drawing it on its own, and packing every
+	texture into one texture array (with the small ones atlased) and drawing all the cubes in one instanced draw.
+	Both modes draw with variants of the one shader in CubeShader.vert and CubeShader.frag, built at startup by
+	ShaderVariants. Q switches to quantized positions and C adds vertex colours, each of which picks another variant.
+	Needs OpenGL 3.1 for texture arrays and instancing. Run it from this folder, it borrows the crate
+	texture from ../firstTexture.
+*/
+
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <cstdlib>
+#include <cstddef>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <fstream>
+#include <string.h>
+#include <vector>
+#include "TextureArrayBuilder.h"
+#include "ShaderVariants.h"
+
+//================
+//GLOBAL VARIABLES
+//================
+//every combination of the cube shader's features
+ShaderVariants shaders;
+//the features each mode needs, on top of whatever extraFeatures() adds
+constexpr uint32_t SEPARATE_FEATURES = FEATURE_TEXTURING;
+constexpr uint32_t BATCHED_FEATURES = FEATURE_INSTANCING | FEATURE_TEXTURING;
+bool quantizedPositions = false;
+bool vertexColors = false;
+bool serialShaders = false;
+
+//one texture per cube, drawn one at a time
+std::vector<GLuint> materialTextures;
+
+//every texture in one array, every cube in one draw. If the driver's layer limit splits the textures over
+//several arrays, the instances are grouped by array and each group is one bind and one draw.
+struct InstanceGroup {
+	GLuint texture;
+	int first, count;
+};
+std::vector<GLuint> arrayTextures;
+std::vector<InstanceGroup> instanceGroups;
+GLuint vbo_instances;
+GLuint vao;
+int maxArrayLayers = 0; //0 goes by GL_MAX_ARRAY_TEXTURE_LAYERS
+
+GLuint vbo_verticies, vbo_quantized, vbo_texcoords, vbo_colors;
+GLuint ibo_elements;
+
+int screenWidth = 800;
+int screenHeight = 600;
+
+const int materialCount = 1000;
+const int layerSize = 128;
+bool batched = true;
+
+//per cube data, uploaded as instanced attributes in batched mode
+struct CubeInstance {
+	glm::mat4 model;
+	glm::vec4 uvRect;
+	float layer;
+};
+std::vector<CubeInstance> cubes;
+glm::mat4 viewProjection;
+
+//per frame counters
+int drawCalls = 0, textureBinds = 0;
+
+//==========
+// MATERIALS
+//==========
+
+//the crate scaled down to size x size and tinted
+std::vector<unsigned char> tintedCrate(const SDL_Surface* crate, int size, const glm::vec3 &tint) {
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	int step = crate->w / size;
+	for(int y = 0; y < size; y++) {
+		for(int x = 0; x < size; x++) {
+			const unsigned char* source = (const unsigned char*)crate->pixels + (y * step) * crate->pitch + (x * step) * 4;
+			unsigned char* target = &pixels[((size_t)y * size + x) * 4];
+			target[0] = (unsigned char)(source[0] * tint.x);
+			target[1] = (unsigned char)(source[1] * tint.y);
+			target[2] = (unsigned char)(source[2] * tint.z);
+			target[3] = source[3];
+		}
+	}
+	return pixels;
+}
+
+//a two colour checkerboard, for the small textures that get atlased
+std::vector<unsigned char> checkerboard(int size, const glm::vec3 &color) {
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	for(int y = 0; y < size; y++) {
+		for(int x = 0; x < size; x++) {
+			float shade = ((x / 4 + y / 4) % 2) ? 1.0f : 0.4f;
+			unsigned char* target = &pixels[((size_t)y * size + x) * 4];
+			target[0] = (unsigned char)(255 * color.x * shade);
+			target[1] = (unsigned char)(255 * color.y * shade);
+			target[2] = (unsigned char)(255 * color.z * shade);
+			target[3] = 255;
+		}
+	}
+	return pixels;
+}
+
+//half the materials are crates, the rest are small checkerboards that get packed into atlas layers
+bool createMaterials(TextureArrayBuilder &builder, std::vector<int> &regions) {
+	SDL_Surface* loaded = IMG_Load("../firstTexture/woodenCrate.png");
+	if(loaded == nullptr) {
+		std::cerr << "IMG_Load: " << IMG_GetError() << std::endl;
+		return false;
+	}
+	SDL_Surface* crate = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ABGR8888, 0);
+	SDL_FreeSurface(loaded);
+	if(crate == nullptr) {
+		std::cerr << "SDL_ConvertSurfaceFormat: " << SDL_GetError() << std::endl;
+		return false;
+	}
+
+	for(int i = 0; i < materialCount; i++) {
+		glm::vec3 tint(0.4f + 0.6f * (i % 7) / 6.0f, 0.4f + 0.6f * (i % 11) / 10.0f, 0.4f + 0.6f * (i % 13) / 12.0f);
+		int size = i % 2 == 0 ? layerSize : (i % 4 == 1 ? 32 : 16);
+		std::vector<unsigned char> pixels = size == layerSize ? tintedCrate(crate, size, tint) : checkerboard(size, tint);
+
+		//separate mode gets its own texture per material
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		materialTextures.push_back(textureID);
+
+		//batched mode gets a region of the array
+		regions.push_back(builder.add(size, size, pixels.data()));
+	}
+	SDL_FreeSurface(crate);
+	return true;
+}
+
+bool initResources() {
+
+	if(!GLEW_VERSION_3_1) {
+		std::cerr << "Texture arrays and instancing need OpenGL 3.1\n";
+		return false;
+	}
+	//a 3.1 context without the compatibility extension has no default vertex array object
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	TextureArrayBuilder builder(layerSize, layerSize);
+	std::vector<int> regions;
+	if(!createMaterials(builder, regions)) {
+		return false;
+	}
+	if(!builder.build(maxArrayLayers)) {
+		return false;
+	}
+	for(int array = 0; array < builder.arrayCount(); array++) {
+		arrayTextures.push_back(builder.texture(array));
+	}
+	std::cout << materialCount << " materials packed into " << builder.layerCount() << " array layers ("
+		<< builder.wholeLayerCount() << " whole, " << builder.layerCount() - builder.wholeLayerCount() << " atlas) in "
+		<< builder.arrayCount() << " array texture" << (builder.arrayCount() == 1 ? "" : "s") << "\n";
+
+	//a 10x10x10 grid of cubes, each with its own material
+	for(int i = 0; i < materialCount; i++) {
+		CubeInstance cube;
+		cube.model = glm::translate(glm::mat4(1.0f), glm::vec3(i % 10 - 4.5f, i / 10 % 10 - 4.5f, i / 100 - 4.5f) * 3.0f);
+		const TextureRegion &region = builder.region(regions[i]);
+		cube.uvRect = glm::vec4(region.u, region.v, region.width, region.height);
+		cube.layer = (float)region.layer;
+		cubes.push_back(cube);
+	}
+
+	//the instance buffer holds the cubes grouped by the array their texture ended up in
+	std::vector<CubeInstance> instances;
+	for(int array = 0; array < builder.arrayCount(); array++) {
+		InstanceGroup group = {arrayTextures[array], (int)instances.size(), 0};
+		for(int i = 0; i < materialCount; i++) {
+			if(builder.region(regions[i]).array == array) {
+				instances.push_back(cubes[i]);
+			}
+		}
+		group.count = (int)instances.size() - group.first;
+		if(group.count > 0) {
+			instanceGroups.push_back(group);
+		}
+	}
+
+	glGenBuffers(1, &vbo_instances);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_instances);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(CubeInstance), instances.data(), GL_STATIC_DRAW);
+
+	//the same textured cube as firstTexture
+	GLfloat cube_texcoords[2*4*6] = {
+		0.0, 0.0,
+		1.0, 0.0,
+		1.0, 1.0,
+		0.0, 1.0
+	};
+
+	for(int i = 1; i < 6; i++) {
+		memcpy(&cube_texcoords[i*4*2], &cube_texcoords[0], 2*4*sizeof(GLfloat));
+	}
+
+	glGenBuffers(1, &vbo_texcoords);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_texcoords);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_texcoords), cube_texcoords, GL_STATIC_DRAW);
+
+	GLfloat verticies[] = {
+		//front of cube
+		-1.0, -1.0,  1.0,
+		 1.0, -1.0,  1.0,
+		 1.0,  1.0,  1.0,
+		-1.0,  1.0,  1.0,
+		//top of cube
+		-1.0,  1.0,  1.0,
+		 1.0,  1.0,  1.0,
+		 1.0,  1.0, -1.0,
+		-1.0,  1.0, -1.0,
+		//back of cube
+		 1.0, -1.0, -1.0,
+		-1.0, -1.0, -1.0,
+		-1.0,  1.0, -1.0,
+		 1.0,  1.0, -1.0,
+		//bottom of cube
+		-1.0, -1.0, -1.0,
+		 1.0, -1.0, -1.0,
+		 1.0, -1.0,  1.0,
+		-1.0, -1.0,  1.0,
+		//left of cube
+		-1.0, -1.0, -1.0,
+		-1.0, -1.0,  1.0,
+		-1.0,  1.0,  1.0,
+		-1.0,  1.0, -1.0,
+		//right of cube
+		1.0,  -1.0,  1.0,
+		1.0,  -1.0, -1.0,
+		1.0,   1.0, -1.0,
+		1.0,   1.0,  1.0,
+	};
+
+	glGenBuffers(1, &vbo_verticies);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(verticies), verticies, GL_STATIC_DRAW);
+
+	//the same positions as normalized shorts, a third of the size. The cube fits in -1 to 1 so the scale is 1.
+	GLshort quantized[sizeof(verticies) / sizeof(GLfloat)];
+	for(size_t i = 0; i < sizeof(verticies) / sizeof(GLfloat); i++) {
+		quantized[i] = (GLshort)std::lround(verticies[i] * 32767.0f);
+	}
+	glGenBuffers(1, &vbo_quantized);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_quantized);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quantized), quantized, GL_STATIC_DRAW);
+
+	//a colour per corner, for the vertex colour variants
+	GLfloat colors[3*4*6];
+	for(int i = 0; i < 4*6; i++) {
+		colors[i * 3] = i % 4 == 1 ? 0.5f : 1.0f;
+		colors[i * 3 + 1] = i % 4 == 2 ? 0.5f : 1.0f;
+		colors[i * 3 + 2] = i % 4 == 3 ? 0.5f : 1.0f;
+	}
+	glGenBuffers(1, &vbo_colors);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_colors);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
+
+	GLushort cube_elements[] = {
+		0, 1, 2,     2, 3, 0,
+		4, 5, 6,     6, 7, 4,
+		8, 9, 10,    10, 11, 8,
+		12, 13, 14,  14, 15, 12,
+		16, 17, 18,  18, 19, 16,
+		20, 21, 22,  22, 23, 20
+	};
+
+	glGenBuffers(1, &ibo_elements);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_elements), cube_elements, GL_STATIC_DRAW);
+
+	//=============
+	// LOAD SHADERS
+	//=============
+
+	return shaders.build("CubeShader.vert", "CubeShader.frag", serialShaders);
+}
+
+//features picked at run time, added to the mode's own
+uint32_t extraFeatures() {
+	return (quantizedPositions ? FEATURE_QUANTIZED_POSITIONS : 0u) | (vertexColors ? FEATURE_VERTEX_COLOR : 0u);
+}
+
+//every variant has its attributes in the same place, so only the buffers change between them
+void bindCube(const ShaderVariant &shader) {
+	if(quantizedPositions) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_quantized);
+		glVertexAttribPointer(ATTRIBUTE_COORD3D, 3, GL_SHORT, GL_TRUE, 0, 0);
+		glUniform1f(shader.positionScale, 1.0f);
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_verticies);
+		glVertexAttribPointer(ATTRIBUTE_COORD3D, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+	glEnableVertexAttribArray(ATTRIBUTE_COORD3D);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_texcoords);
+	glEnableVertexAttribArray(ATTRIBUTE_TEXCOORD);
+	glVertexAttribPointer(ATTRIBUTE_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	if(vertexColors) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_colors);
+		glEnableVertexAttribArray(ATTRIBUTE_V_COLOR);
+		glVertexAttribPointer(ATTRIBUTE_V_COLOR, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
+}
+
+void unbindCube() {
+	glDisableVertexAttribArray(ATTRIBUTE_COORD3D);
+	glDisableVertexAttribArray(ATTRIBUTE_TEXCOORD);
+	glDisableVertexAttribArray(ATTRIBUTE_V_COLOR);
+}
+
+//one bind and one draw per cube
+void renderSeparate() {
+	const ShaderVariant &shader = shaders[SEPARATE_FEATURES | extraFeatures()];
+	glUseProgram(shader.program);
+	bindCube(shader);
+	glActiveTexture(GL_TEXTURE0);
+	for(size_t i = 0; i < cubes.size(); i++) {
+		glBindTexture(GL_TEXTURE_2D, materialTextures[i]);
+		textureBinds++;
+		glm::mat4 mvp = viewProjection * cubes[i].model;
+		glUniformMatrix4fv(shader.mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+		drawCalls++;
+	}
+	unbindCube();
+}
+
+//one bind and one instanced draw for every cube (or for every array texture, if there's more than one)
+void renderBatched() {
+	const ShaderVariant &shader = shaders[BATCHED_FEATURES | extraFeatures()];
+	glUseProgram(shader.program);
+	glUniformMatrix4fv(shader.viewProjection, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	bindCube(shader);
+	glActiveTexture(GL_TEXTURE0);
+
+	//a mat4 attribute takes up four locations, one per column
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_instances);
+	for(int column = 0; column < 4; column++) {
+		glEnableVertexAttribArray(ATTRIBUTE_MODEL + column);
+		glVertexAttribDivisor(ATTRIBUTE_MODEL + column, 1);
+	}
+	glEnableVertexAttribArray(ATTRIBUTE_UV_RECT);
+	glVertexAttribDivisor(ATTRIBUTE_UV_RECT, 1);
+	glEnableVertexAttribArray(ATTRIBUTE_LAYER);
+	glVertexAttribDivisor(ATTRIBUTE_LAYER, 1);
+
+	for(const InstanceGroup &group : instanceGroups) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, group.texture);
+		textureBinds++;
+		//point the instanced attributes at the group's first cube
+		size_t base = group.first * sizeof(CubeInstance);
+		for(int column = 0; column < 4; column++) {
+			glVertexAttribPointer(ATTRIBUTE_MODEL + column, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+				(void*)(base + offsetof(CubeInstance, model) + sizeof(glm::vec4) * column));
+		}
+		glVertexAttribPointer(ATTRIBUTE_UV_RECT, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)(base + offsetof(CubeInstance, uvRect)));
+		glVertexAttribPointer(ATTRIBUTE_LAYER, 1, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)(base + offsetof(CubeInstance, layer)));
+		glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0, group.count);
+		drawCalls++;
+	}
+
+	//leave the divisors at 0 so the attribute locations behave normally in separate mode
+	for(int column = 0; column < 4; column++) {
+		glVertexAttribDivisor(ATTRIBUTE_MODEL + column, 0);
+		glDisableVertexAttribArray(ATTRIBUTE_MODEL + column);
+	}
+	glVertexAttribDivisor(ATTRIBUTE_UV_RECT, 0);
+	glDisableVertexAttribArray(ATTRIBUTE_UV_RECT);
+	glVertexAttribDivisor(ATTRIBUTE_LAYER, 0);
+	glDisableVertexAttribArray(ATTRIBUTE_LAYER);
+	unbindCube();
+}
+
+void render(SDL_Window* window) {
+	glClearColor(0.0, 0.0, 0.0, 1.0);
+	glEnable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if(batched) {
+		renderBatched();
+	} else {
+		renderSeparate();
+	}
+
+	//display the result
+	SDL_GL_SwapWindow(window);
+}
+
+void logic() {
+	//turn the whole grid slowly so every cube stays on screen
+	float angle = SDL_GetTicks() / 1000.0 * 15; //15 degrees per second
+	glm::mat4 spin = glm::rotate(glm::mat4(1.0), glm::radians(angle), glm::vec3(0, 1, 0));
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0, 20.0, 45.0), glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f * screenWidth / screenHeight, 0.1f, 200.0f);
+	viewProjection = projection * view * spin;
+}
+
+//loop and process events
+void mainLoop(SDL_Window* window) {
+	const double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+	double submitTime = 0.0, frameTime = 0.0;
+	int frames = 0, totalDraws = 0, totalBinds = 0;
+	Uint64 lastFrame = SDL_GetPerformanceCounter();
+
+	while(true) {
+		SDL_Event event;
+		while(SDL_PollEvent(&event)) {
+			if(event.type == SDL_QUIT) {
+				return;
+			} else if(event.type == SDL_KEYDOWN) {
+				switch(event.key.keysym.sym) {
+					//if the end key is pressed, end the program
+					case SDLK_END:
+					exit(0);
+					break;
+					//switch between one draw per cube and one draw for everything
+					case SDLK_b:
+					batched = !batched;
+					frames = totalDraws = totalBinds = 0;
+					submitTime = frameTime = 0.0;
+					break;
+					//switch shader variants
+					case SDLK_q:
+					quantizedPositions = !quantizedPositions;
+					break;
+					case SDLK_c:
+					vertexColors = !vertexColors;
+					break;
+				}
+			}
+		}
+		logic();
+
+		drawCalls = textureBinds = 0;
+		Uint64 start = SDL_GetPerformanceCounter();
+		render(window);
+		Uint64 end = SDL_GetPerformanceCounter();
+
+		submitTime += (end - start) * msPerCount;
+		frameTime += (end - lastFrame) * msPerCount;
+		totalDraws += drawCalls;
+		totalBinds += textureBinds;
+		lastFrame = end;
+		if(++frames == 120) {
+			std::printf("%s (%s): %d draw calls, %d texture binds per frame, %.3f ms submitting, %.3f ms per frame\n",
+				batched ? "texture array + instancing" : "texture per cube",
+				ShaderVariants::describe((batched ? BATCHED_FEATURES : SEPARATE_FEATURES) | extraFeatures()).c_str(),
+				totalDraws / frames, totalBinds / frames, submitTime / frames, frameTime / frames);
+			frames = totalDraws = totalBinds = 0;
+			submitTime = frameTime = 0.0;
+		}
+	}
+}
+
+//clean up used memory
+void freeResources() {
+	shaders.destroy();
+	glDeleteTextures((GLsizei)materialTextures.size(), materialTextures.data());
+	glDeleteTextures((GLsizei)arrayTextures.size(), arrayTextures.data());
+	glDeleteBuffers(1, &vbo_instances);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo_verticies);
+	glDeleteBuffers(1, &vbo_quantized);
+	glDeleteBuffers(1, &vbo_texcoords);
+	glDeleteBuffers(1, &vbo_colors);
+	glDeleteBuffers(1, &ibo_elements);
+}
+
+int main(int argc, char** argv) {
+	//--separate          start with one draw per cube instead of the batched draw
+	//--quantized         start with quantized positions (toggle with Q)
+	//--vertex-color      start with vertex colours (toggle with C)
+	//--serial-shaders    build the shader variants one at a time, to compare startup time
+	//--max-layers N      split the texture array every N layers, to try the split on a driver that allows lots of layers
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--separate") == 0) {
+			batched = false;
+		} else if(strcmp(argv[i], "--quantized") == 0) {
+			quantizedPositions = true;
+		} else if(strcmp(argv[i], "--vertex-color") == 0) {
+			vertexColors = true;
+		} else if(strcmp(argv[i], "--serial-shaders") == 0) {
+			serialShaders = true;
+		} else if(strcmp(argv[i], "--max-layers") == 0 && i + 1 < argc) {
+			maxArrayLayers = std::max(1, atoi(argv[++i]));
+		}
+	}
+
+	SDL_Init(SDL_INIT_EVERYTHING);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+	SDL_Window* window = SDL_CreateWindow("Texture Batching", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, screenWidth, screenHeight, SDL_WINDOW_OPENGL);
+	if(window == nullptr) {
+		std::cerr << SDL_GetError() << std::endl;
+		exit(1);
+	}
+	SDL_GL_CreateContext(window);
+
+	GLenum glewStatus = glewInit();
+	if(glewStatus != GLEW_OK) {
+		std::cerr << glewGetErrorString(glewStatus) << std::endl;
+	}
+
+	if(!initResources()) {
+		std::cerr << "initResources failed!\n";
+		exit(1);
+	}
+
+	mainLoop(window);
+	freeResources();
+	return 0;
+}